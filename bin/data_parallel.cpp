@@ -0,0 +1,103 @@
+//
+// Strong-scaling benchmark for data-parallel training over shared memory: a fixed
+// global batch is sharded across 1..N processes and rank 0 reports throughput.
+//
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "DataParallel.h"
+#include "MultiLayerPerceptron.h"
+#include "Random.h"
+#include "SharedMemoryTransport.h"
+
+namespace {
+    constexpr size_t kSamples = 256;
+
+    void train(size_t rank, size_t worldSize, size_t steps, const std::string &name) {
+        Random::seed(0);
+        MultiLayerPerceptron mlp(2, {20, 20, 10, 1});
+
+        // Deterministic synthetic data; rank r takes every worldSize-th sample
+        std::vector<float> features(2 * kSamples);
+        Random::uniform({features.data(), features.size()}, -1.0f, 1.0f, 1, 0, 1);
+        std::vector<Value> inputs;
+        std::vector<float> targets;
+        for (size_t i = rank; i < kSamples; i += worldSize) {
+            inputs.push_back(Value {features[2 * i], features[2 * i + 1]});
+            inputs.back().setRequiresGrad(false);
+            targets.push_back(features[2 * i] * features[2 * i + 1] > 0.0f ? 1.0f : -1.0f);
+        }
+        Value expected(targets.size(), targets.data());
+        expected.setRequiresGrad(false);
+
+        SharedMemoryTransport transport(name, rank, worldSize);
+        DataParallel parallel(mlp, transport);
+        auto parameters = mlp.getParameters();
+
+        transport.barrier();
+        auto start = std::chrono::steady_clock::now();
+        float loss = 0.0f;
+        for (size_t step = 0; step < steps; ++step) {
+            Value predictions(inputs.size());
+            std::vector<Value *> observed;
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                observed.push_back(mlp(inputs[i], predictions.outputSlice(i, 1)));
+            }
+
+            auto l = Value::concat(observed)->mse(expected);
+            parallel.backward(*l);
+            loss = l->at(0);
+
+            for (auto &parameter: *parameters) {
+                auto data = parameter->getDataSpan();
+                auto grad = parameter->getGradSpan();
+                for (size_t i = 0; i < data.size(); ++i) {
+                    data[i] -= 0.05f * grad[i];
+                }
+                parameter->markModified();
+            }
+            Value::clearGrads();
+        }
+        transport.barrier();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (rank == 0) {
+            std::cout << worldSize << " processes: " << static_cast<double>(kSamples * steps) / elapsed.count()
+                      << " samples/sec, final shard loss " << loss << std::endl;
+        }
+    }
+}
+
+// Usage: data_parallel [max processes] [steps]
+int main(int argc, char **argv) {
+    size_t maxProcesses = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+    size_t steps = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20;
+
+    for (size_t worldSize = 1; worldSize <= maxProcesses; ++worldSize) {
+        auto name = "/smolgrad-bench-" + std::to_string(getpid()) + "-" + std::to_string(worldSize);
+
+        std::vector<pid_t> children;
+        for (size_t rank = 0; rank < worldSize; ++rank) {
+            pid_t child = fork();
+            if (child == 0) {
+                train(rank, worldSize, steps, name);
+                _exit(0);
+            }
+            children.push_back(child);
+        }
+
+        for (auto child: children) {
+            int status = 0;
+            waitpid(child, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::cerr << "rank exited abnormally" << std::endl;
+                return 1;
+            }
+        }
+    }
+}
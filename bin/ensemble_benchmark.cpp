@@ -0,0 +1,89 @@
+//
+// Training throughput of K copies of the mlp demo network, as K separate models and as
+// one Ensemble, on the mlp demo problem with a different learning rate per member.
+//
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "Ensemble.h"
+#include "MultiLayerPerceptron.h"
+#include "Random.h"
+
+// Usage: ensemble_benchmark [epochs]
+int main(int argc, char **argv) {
+    size_t epochs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20;
+
+    std::vector<std::vector<float>> xs{{0.5f, 0.1f}, {0.7f, 1.0f}, {0.1f, -0.2f},
+                                       {-0.1f, 1.0f}, {-0.5f, -0.1f}, {-0.3f, 0.2f}};
+    std::vector<float> ys{1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f};
+    std::vector<Value> inputs;
+    std::vector<Value> targets;
+    for (size_t i = 0; i < xs.size(); ++i) {
+        inputs.emplace_back(xs[i].size(), xs[i].data());
+        inputs.back().setRequiresGrad(false);
+        targets.push_back(Value{ys[i]});
+        targets.back().setRequiresGrad(false);
+    }
+
+    std::cout << "members, separate steps/s, ensemble steps/s, speedup, ensemble final loss min/max" << std::endl;
+    for (size_t members: {1, 4, 16, 64, 256}) {
+        // A log-spaced learning rate sweep from 0.01 to 0.3
+        std::vector<float> learningRates;
+        for (size_t m = 0; m < members; ++m) {
+            float t = members > 1 ? static_cast<float>(m) / static_cast<float>(members - 1) : 0.0f;
+            learningRates.push_back(0.01f * std::pow(30.0f, t));
+        }
+
+        Random::seed(0);
+        std::vector<MultiLayerPerceptron> models;
+        for (size_t m = 0; m < members; ++m) {
+            models.emplace_back(2, std::vector<size_t>{20, 20, 10, 1});
+        }
+        Ensemble ensemble(models);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t m = 0; m < members; ++m) {
+            auto parameters = models[m].getParameters();
+            for (size_t epoch = 0; epoch < epochs; ++epoch) {
+                for (size_t i = 0; i < inputs.size(); ++i) {
+                    Value::clearGrads();
+                    models[m](inputs[i])->mse(targets[i])->backward();
+                    for (auto &parameter: *parameters) {
+                        parameter->step(learningRates[m]);
+                    }
+                }
+            }
+        }
+        std::chrono::duration<double> separate = std::chrono::steady_clock::now() - start;
+
+        std::vector<float> losses(members, 0.0f);
+        start = std::chrono::steady_clock::now();
+        for (size_t epoch = 0; epoch < epochs; ++epoch) {
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                Value::clearGrads();
+                auto loss = ensemble(inputs[i])->mse(targets[i], members);
+                loss->sum()->backward();
+                ensemble.step(learningRates);
+                if (epoch + 1 == epochs) {
+                    for (size_t m = 0; m < members; ++m) {
+                        losses[m] += loss->at(m) / static_cast<float>(inputs.size());
+                    }
+                }
+            }
+        }
+        std::chrono::duration<double> stacked = std::chrono::steady_clock::now() - start;
+
+        // One step is one member trained on one sample
+        double steps = static_cast<double>(members * epochs * inputs.size());
+        float lowest = losses[0], highest = losses[0];
+        for (float loss: losses) {
+            lowest = std::min(lowest, loss);
+            highest = std::max(highest, loss);
+        }
+        std::cout << members << ", " << steps / separate.count() << ", " << steps / stacked.count() << ", "
+                  << separate.count() / stacked.count() << ", " << lowest << "/" << highest << std::endl;
+    }
+}
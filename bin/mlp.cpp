@@ -1,10 +1,19 @@
 //
 // Created by tom on 20/07/23.
 //
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
 
+#include "BatchScorer.h"
 #include "MultiLayerPerceptron.h"
 #include "Neuron.h"
+#include "Telemetry.h"
 #include "Value.h"
 
 // render a vector of floats
@@ -20,9 +29,104 @@ std::ostream &operator<<(std::ostream &os, const std::vector<float> &vec) {
     return os;
 }
 
+// Parses a whole non-negative decimal number, rejecting anything else
+bool parseCount(const char *text, size_t &value) {
+    char *end = nullptr;
+    errno = 0;
+    auto parsed = std::strtoull(text, &end, 10);
+    if (*text < '0' || *text > '9' || *end != '\0' || errno == ERANGE) {
+        return false;
+    }
+    value = static_cast<size_t>(parsed);
+    return true;
+}
+
+// Batch scoring mode: mlp score --model FILE --input FILE --output FILE [--threads N] [--batch ROWS]
+// Formats follow the extensions: .csv is CSV, anything else raw float32. "-" writes to stdout.
+int score(int argc, char **argv) {
+    std::string model, input, output = "-";
+    BatchScorer::Options options;
+    for (int i = 2; i < argc; i += 2) {
+        std::string flag = argv[i];
+        if (i + 1 == argc) {
+            std::cerr << "missing value for " << flag << std::endl;
+            return 2;
+        }
+        if (flag == "--model") {
+            model = argv[i + 1];
+        } else if (flag == "--input") {
+            input = argv[i + 1];
+        } else if (flag == "--output") {
+            output = argv[i + 1];
+        } else if (flag == "--threads" || flag == "--batch") {
+            if (!parseCount(argv[i + 1], flag == "--threads" ? options.threads : options.batchRows)) {
+                std::cerr << flag << " expects a number, got " << argv[i + 1] << std::endl;
+                return 2;
+            }
+        } else {
+            std::cerr << "unknown option " << flag << std::endl;
+            return 2;
+        }
+    }
+    if (model.empty() || input.empty()) {
+        std::cerr << "usage: mlp score --model FILE --input FILE [--output FILE] [--threads N] [--batch ROWS]"
+                  << std::endl;
+        return 2;
+    }
+
+    BatchScorer::Report report;
+    try {
+        std::ifstream modelFile(model, std::ios::binary);
+        if (!modelFile) {
+            throw std::runtime_error("cannot open " + model);
+        }
+        auto mlp = MultiLayerPerceptron::load(modelFile);
+        BatchScorer scorer(mlp);
+        options.outputFormat = output == "-" ? BatchScorer::Format::Csv : BatchScorer::formatOf(output);
 
-// main function
+        std::ofstream outputFile;
+        if (output != "-") {
+            outputFile.open(output, std::ios::binary | std::ios::trunc);
+            if (!outputFile) {
+                throw std::runtime_error("cannot open " + output);
+            }
+        }
+        report = scorer.score(input, BatchScorer::formatOf(input), output == "-" ? std::cout : outputFile, options);
+    } catch (const std::exception &e) {
+        std::cerr << "mlp score: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cerr << report.rows << " rows in " << report.seconds << " s, " << report.rowsPerSecond << " rows/s" << std::endl
+              << report.batches << " batches, latency p50 " << report.p50 * 1e3 << " ms, p90 " << report.p90 * 1e3
+              << " ms, p99 " << report.p99 * 1e3 << " ms, max " << report.max * 1e3 << " ms" << std::endl;
+    return 0;
+}
+
+// main function; with "--save FILE" the trained demo network is written out for "mlp score",
+// and with "--metrics PREFIX" per-step telemetry goes to PREFIX.jsonl and PREFIX.prom
 int main(int argc, char **argv) {
+    if (argc > 1 && std::string(argv[1]) == "score") {
+        return score(argc, argv);
+    }
+
+    std::string savePath, metricsPrefix;
+    for (int i = 1; i < argc; i += 2) {
+        std::string flag = argv[i];
+        if (i + 1 == argc) {
+            std::cerr << "missing value for " << flag << std::endl;
+            return 2;
+        }
+        if (flag == "--save") {
+            savePath = argv[i + 1];
+        } else if (flag == "--metrics") {
+            metricsPrefix = argv[i + 1];
+        } else {
+            std::cerr << "usage: mlp [--save FILE] [--metrics PREFIX] | mlp score ..." << std::endl;
+            return 2;
+        }
+    }
+
     auto neuron = Neuron(2);
 
     // print neuron params
@@ -101,38 +205,63 @@ int main(int argc, char **argv) {
             new Value {-0.3f, 0.2f}
     };
 
-    auto expected = std::vector<Value *> {
-            new Value {1.0f},
-            new Value {0.0f},
-            new Value {1.0f},
-            new Value {0.0f},
-            new Value {1.0f},
-            new Value {1.0f}
-    };
+    auto expected = Value {1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f};
+
+    // Inputs and targets never need gradients
+    for (auto value: inputs) {
+        value->setRequiresGrad(false);
+    }
+    expected.setRequiresGrad(false);
+
+    std::unique_ptr<Telemetry> telemetry;
+    if (!metricsPrefix.empty()) {
+        Telemetry::Options options;
+        options.jsonPath = metricsPrefix + ".jsonl";
+        options.prometheusPath = metricsPrefix + ".prom";
+        try {
+            telemetry = std::make_unique<Telemetry>(options);
+        } catch (const std::exception &e) {
+            std::cerr << "mlp: " << e.what() << std::endl;
+            return 1;
+        }
+    }
 
     for (size_t step = 0; step < 1000; ++step) {
+        auto start = std::chrono::steady_clock::now();
 
+        // Predictions are written into adjacent slots of one buffer, so concatenating them is free
+        Value predictions(inputs.size());
         std::vector<Value *> observed;
 
-        for (auto input: inputs) {
-            observed.push_back(mlp(*input));
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            observed.push_back(mlp(*inputs[i], predictions.outputSlice(i, 1)));
         }
 
         auto o = Value::concat(observed);
-        auto e = Value::concat(expected);
 
-        auto diff = *o - *e;
-        auto l = diff->dot(*diff);
+        auto l = o->mse(expected);
 
 
         // Print loss
 //        std::cout << "Loss: " << *l->getData() << std::endl;
 
+        Telemetry::Step metrics;
+        metrics.step = step;
+        metrics.samples = inputs.size();
+        metrics.loss = l->at(0);
+        metrics.forwardSeconds = Telemetry::secondsSince(start);
+        start = std::chrono::steady_clock::now();
+
         // Calculate gradient
         l->backward();
+        metrics.backwardSeconds = Telemetry::secondsSince(start);
+        start = std::chrono::steady_clock::now();
 
         // Update parameters
         auto parameters = mlp.getParameters();
+        if (telemetry) {
+            metrics.gradientNorm = Telemetry::gradientNorm(*parameters);
+        }
         for (auto &parameter: *parameters) {
 //            auto grad = parameter->getGrad();
 //
@@ -143,10 +272,30 @@ int main(int argc, char **argv) {
 //
 //            *parameter = *sos;
 
-            *parameter -= *(*parameter->getGrad() * 0.01);
-
+            parameter->step(0.05f);
             parameter->clearGrad();
         }
+        metrics.optimizerSeconds = Telemetry::secondsSince(start);
+        if (telemetry) {
+            telemetry->record(metrics);
+        }
+    }
+
+    if (!savePath.empty()) {
+        try {
+            std::ofstream modelFile(savePath, std::ios::binary | std::ios::trunc);
+            if (!modelFile) {
+                throw std::runtime_error("cannot open " + savePath);
+            }
+            mlp.save(modelFile);
+            modelFile.close();
+            if (!modelFile) {
+                throw std::runtime_error("cannot write " + savePath);
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "mlp: " << e.what() << std::endl;
+            return 1;
+        }
     }
 
     std::cout << "Hello, world!" << std::endl;
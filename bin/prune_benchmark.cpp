@@ -0,0 +1,83 @@
+//
+// Latency of one pruned layer at increasing sparsity: the graph-building Layer path,
+// a plain dense matrix-vector product over the same weights, and the block-sparse path.
+//
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "BlockSparseLayer.h"
+#include "Pruner.h"
+#include "Random.h"
+
+namespace {
+    template <typename Body>
+    double nanosecondsPerCall(size_t calls, Body body) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < calls; i++) {
+            body();
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / static_cast<double>(calls);
+    }
+}
+
+// Usage: prune_benchmark [width] [calls]
+int main(int argc, char **argv) {
+    size_t width = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 512;
+    size_t calls = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+
+    std::vector<float> input(width);
+    Random::uniform({input.data(), input.size()}, -1.0f, 1.0f, 1, 0, 1);
+    Value inputValue(width, input.data());
+    inputValue.setRequiresGrad(false);
+    std::vector<float> output(width);
+    float sink = 0.0f;
+
+    std::cout << "sparsity, layer ns, dense ns, block-sparse ns, block density" << std::endl;
+    for (float sparsity : {0.0f, 0.5f, 0.75f, 0.9f, 0.95f, 0.99f}) {
+        Random::seed(0);
+        MultiLayerPerceptron mlp(width, {width}, {Activation::ReLU});
+        Pruner pruner(mlp);
+        pruner.pruneGlobal(sparsity);
+        auto &layer = *mlp.getLayers()[0];
+
+        // Row-major copy of the pruned weights for the dense baseline
+        std::vector<float> weights;
+        std::vector<float> bias;
+        auto parameters = layer.getParameters();
+        for (size_t o = 0; o < width; o++) {
+            auto weight = (*parameters)[2 * o]->getDataSpan();
+            weights.insert(weights.end(), weight.begin(), weight.end());
+            bias.push_back((*parameters)[2 * o + 1]->at(0));
+        }
+        BlockSparseLayer compressed(layer);
+
+        double layerTime = nanosecondsPerCall(calls / 20 + 1, [&]() {
+            Value::NoGrad noGrad;
+            sink += layer(inputValue)->at(0);
+        });
+        double denseTime = nanosecondsPerCall(calls, [&]() {
+            for (size_t o = 0; o < width; o++) {
+                float sum = 0.0f;
+                for (size_t i = 0; i < width; i++) {
+                    sum += weights[o * width + i] * input[i];
+                }
+                sum += bias[o];
+                output[o] = sum > 0.0f ? sum : 0.0f;
+            }
+            sink += output[0];
+        });
+        double sparseTime = nanosecondsPerCall(calls, [&]() {
+            compressed(input.data(), output.data());
+            sink += output[0];
+        });
+
+        std::cout << sparsity << ", " << layerTime << ", " << denseTime << ", " << sparseTime << ", "
+                  << compressed.getDensity() << std::endl;
+    }
+
+    // Keep the results observable so no path is optimised away
+    return sink == 42.0f;
+}
@@ -0,0 +1,72 @@
+//
+// Wall-clock time to reach a target loss on the mlp demo problem with gradient descent,
+// L-BFGS and Newton-CG, all full batch from the same initial weights.
+//
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Curvature.h"
+#include "LBFGS.h"
+#include "MultiLayerPerceptron.h"
+#include "NewtonCG.h"
+#include "Random.h"
+
+// Usage: second_order_benchmark [target loss] [max steps]
+int main(int argc, char **argv) {
+    float targetLoss = argc > 1 ? std::strtof(argv[1], nullptr) : 1e-3f;
+    size_t maxSteps = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5000;
+
+    std::vector<std::vector<float>> xs{{0.5f, 0.1f}, {0.7f, 1.0f}, {0.1f, -0.2f},
+                                       {-0.1f, 1.0f}, {-0.5f, -0.1f}, {-0.3f, 0.2f}};
+    std::vector<Value> inputs;
+    for (auto &x: xs) {
+        inputs.emplace_back(x.size(), x.data());
+        inputs.back().setRequiresGrad(false);
+    }
+    Value expected{1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f};
+    expected.setRequiresGrad(false);
+
+    std::cout << "optimizer, steps, seconds, final loss" << std::endl;
+    for (std::string name: {"gradient descent", "L-BFGS", "Newton-CG"}) {
+        Random::seed(0);
+        MultiLayerPerceptron mlp(2, {20, 20, 10, 1});
+        auto parameters = mlp.getParameters();
+        Curvature::Objective objective = [&]() {
+            std::vector<Value *> outputs;
+            for (auto &input: inputs) {
+                outputs.push_back(mlp(input));
+            }
+            return Value::concat(outputs)->mse(expected);
+        };
+
+        LBFGS lbfgs(parameters);
+        NewtonCG newton(parameters);
+        std::vector<float> gradient;
+        float loss = 0.0f;
+        size_t steps = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (; steps < maxSteps; ++steps) {
+            if (name == "gradient descent") {
+                loss = Curvature::gradient(*parameters, objective, gradient);
+                if (loss <= targetLoss) {
+                    break;
+                }
+                for (auto &parameter: *parameters) {
+                    parameter->step(0.05f);
+                }
+            } else {
+                loss = name == "L-BFGS" ? lbfgs.step(objective) : newton.step(objective);
+                if (loss <= targetLoss) {
+                    break;
+                }
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << name << ", " << steps << ", " << elapsed.count() << ", " << loss << std::endl;
+    }
+}
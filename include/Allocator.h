@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Source of the float buffers behind every Value. Small buffers come from the heap;
+// buffers of at least the huge page threshold are mapped directly, so they can be
+// backed by 2 MB pages and placed on a chosen NUMA node. Settings are read from the
+// environment on first use and can be changed at runtime:
+//   SMOLGRAD_HUGE_PAGES  off | transparent (default) | explicit
+//   SMOLGRAD_NUMA        local (default, first touch) | interleave | <node>
+// A node must be below 256; an invalid SMOLGRAD_NUMA value is ignored.
+class Allocator {
+public:
+    enum class HugePages {
+        Off,
+        Transparent,
+        Explicit
+    };
+
+    // NUMA node used with Placement::Node
+    enum class Placement {
+        Local,
+        Interleave,
+        Node
+    };
+
+    // Frees through whichever path allocated the buffer
+    struct Deleter {
+        size_t bytes = 0;
+        bool mapped = false;
+
+        void operator()(float *data) const;
+    };
+
+    using Buffer = std::unique_ptr<float[], Deleter>;
+
+    // Zero-initialised buffer of `size` floats
+    static Buffer allocate(size_t size);
+
+    // Bytes held by buffers that have not been freed yet
+    static size_t getLiveBytes();
+
+    // Runtime configuration
+    static void setHugePages(HugePages hugePages);
+    // Throws std::out_of_range unless 0 <= node < 256
+    static void setPlacement(Placement placement, int node = 0);
+    static void setMappingThreshold(size_t bytes);
+
+private:
+    struct Settings;
+    static Settings &settings();
+    static std::atomic<size_t> sLiveBytes;
+};
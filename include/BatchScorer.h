@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "MultiLayerPerceptron.h"
+
+// Offline scoring of large feature files. The model's weights are copied into plain
+// dense layers, the input file is memory-mapped, and worker threads parse and score
+// minibatches in parallel while the calling thread writes predictions in input order.
+// At most a fixed number of minibatches are buffered ahead of the writer, so memory
+// stays bounded however large the input is.
+class BatchScorer {
+public:
+    enum class Format {
+        // Row-major float32 in host byte order, no header
+        Binary,
+        // One row per line, comma separated; a non-numeric first line is taken as a header
+        Csv
+    };
+
+    struct Options {
+        // 0 uses every hardware thread
+        size_t threads = 0;
+        size_t batchRows = 4096;
+        // Minibatches buffered ahead of the writer; 0 means two per thread
+        size_t inFlight = 0;
+        Format outputFormat = Format::Csv;
+    };
+
+    struct Report {
+        size_t rows = 0;
+        size_t batches = 0;
+        double seconds = 0.0;
+        double rowsPerSecond = 0.0;
+        // Minibatch latency from dispatch to formatted output, in seconds
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    // Constructors
+    explicit BatchScorer(MultiLayerPerceptron &model);
+
+    size_t getNIn() const;
+    size_t getNOut() const;
+
+    // Forward pass over `rows` rows of getNIn() floats; `scratch` is reused between calls
+    void predict(const float *input, size_t rows, float *output, std::vector<float> &scratch) const;
+
+    // Score every row of `inputPath`, streaming getNOut() predictions per row to `output`
+    Report score(const std::string &inputPath, Format inputFormat, std::ostream &output, const Options &options) const;
+
+    // .csv files are CSV, anything else binary
+    static Format formatOf(const std::string &path);
+
+private:
+    struct DenseLayer {
+        size_t nIn;
+        size_t nOut;
+        Activation activation;
+        // Row-major [nOut][nIn]
+        std::vector<float> weights;
+        std::vector<float> bias;
+    };
+
+    std::vector<DenseLayer> mLayers;
+};
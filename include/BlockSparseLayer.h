@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Layer.h"
+
+// Inference-only copy of a (pruned) Layer in block-sparse row format: each neuron's
+// weights are cut into blocks of kBlockSize consecutive inputs, and only blocks with a
+// nonzero weight are stored. The product runs a fixed-width inner loop per block that
+// the compiler vectorises, with no graph or allocation.
+class BlockSparseLayer {
+public:
+    static constexpr size_t kBlockSize = 4;
+
+    // Constructors
+    explicit BlockSparseLayer(Layer &layer);
+
+    // Shape
+    size_t getNIn() const;
+    size_t getNOut() const;
+
+    // Fraction of weight blocks stored
+    float getDensity() const;
+
+    // Evaluate the layer on `input` (getNIn() floats) into `output` (getNOut() floats)
+    void operator()(const float *input, float *output) const;
+
+private:
+    size_t mNIn;
+    size_t mNOut;
+    Activation mActivation;
+    std::vector<size_t> mRowStart;
+    std::vector<uint32_t> mBlockColumn;
+    std::vector<float> mBlockWeights;
+    std::vector<float> mBias;
+};
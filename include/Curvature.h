@@ -0,0 +1,43 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Value.h"
+
+// Flattened view of a parameter list, e.g. MultiLayerPerceptron::getParameters(), for
+// optimizers working on one vector: values, gradients and Hessian-vector products.
+class Curvature {
+public:
+    using Parameters = std::vector<std::shared_ptr<Value>>;
+
+    // Builds the loss from the current parameter values; must be deterministic (full batch)
+    using Objective = std::function<Value*()>;
+
+    static size_t getSize(const Parameters &parameters);
+    static std::vector<float> getData(const Parameters &parameters);
+    static void setData(const Parameters &parameters, const std::vector<float> &data);
+
+    // Loss at the current parameters, writing its flattened gradient to `gradient`
+    static float gradient(const Parameters &parameters, const Objective &objective, std::vector<float> &gradient);
+
+    // Loss alone, without recording a graph
+    static float loss(const Objective &objective);
+
+    // Backtracking line search from the current parameters along `direction`, whose dot
+    // product with the gradient at `loss` is `slope`. Tries `step`, then halves it up to
+    // kMaxHalvings times until `evaluate`, called with the trial point set, returns a loss
+    // with sufficient decrease (Armijo). On success the parameters stay at the accepted
+    // point and `step` holds its size; otherwise they are restored and false is returned.
+    static constexpr size_t kMaxHalvings = 20;
+    static bool lineSearch(const Parameters &parameters, const std::vector<float> &direction, float loss,
+                           float slope, const std::function<float()> &evaluate, float &step);
+
+    // Inner product of two flattened vectors, accumulated in double
+    static float dot(const std::vector<float> &a, const std::vector<float> &b);
+
+    // H v by forward-over-reverse: one forward pass with the parameter tangents set to
+    // v, then one backward pass. The Hessian itself is never formed.
+    static std::vector<float> hessianVectorProduct(const Parameters &parameters, const Objective &objective,
+                                                   const std::vector<float> &v);
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "MultiLayerPerceptron.h"
+#include "Transport.h"
+
+// Data-parallel training of one MultiLayerPerceptron replica per rank. Gradients are
+// grouped into buckets of about `bucketSize` floats, and each bucket is averaged across
+// ranks on a communication thread as soon as backward() has finished with it, so the
+// reduction of late layers overlaps the backward pass through earlier ones.
+class DataParallel {
+public:
+    // Constructors
+    DataParallel(MultiLayerPerceptron &model, Transport &transport, size_t bucketSize = 1 << 16);
+
+    // Average the parameters across ranks so every replica starts identical
+    void synchronizeParameters();
+
+    // Backward pass from `loss`, leaving every parameter gradient averaged across ranks.
+    // Throws whatever the backward pass or the transport throws.
+    void backward(Value &loss);
+
+private:
+    struct Bucket {
+        std::vector<std::shared_ptr<Value>> parameters;
+        std::vector<float> buffer;
+        size_t pending = 0;
+        bool ready = false;
+    };
+
+    // Flatten, allreduce and scatter back one bucket's gradients
+    void reduce(Bucket &bucket);
+
+    Transport &mTransport;
+    std::shared_ptr<std::vector<std::shared_ptr<Value>>> mParameters;
+    std::vector<Bucket> mBuckets;
+    std::unordered_map<Value *, size_t> mBucketOf;
+    std::mutex mMutex;
+    std::condition_variable mReady;
+    // Set when backward() unwinds, so the communicator gives up on buckets never filled
+    bool mStopping = false;
+};
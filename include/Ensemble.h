@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "MultiLayerPerceptron.h"
+
+// Several networks of one architecture trained side by side, e.g. for a learning rate
+// sweep. Each layer keeps the weights of every member in one stacked Value of
+// [members][nOut][nIn] and evaluates them with Value::stackedAffine(), so a forward pass
+// records two nodes per layer however many members there are. Members share nothing but
+// the architecture: their parameters, gradients and learning rates are independent.
+class Ensemble {
+public:
+    // Constructors; members are initialised like MultiLayerPerceptron's
+    Ensemble(size_t members, size_t nIn, std::vector<size_t> nOuts);
+    Ensemble(size_t members, size_t nIn, std::vector<size_t> nOuts, std::vector<Activation> activations);
+
+    // Stack existing networks, which must all have the same architecture
+    explicit Ensemble(std::vector<MultiLayerPerceptron> &models);
+
+    size_t getMembers() const;
+    size_t getNIn() const;
+    size_t getNOut() const;
+
+    // Stacked weight and bias of every layer
+    std::shared_ptr<std::vector<std::shared_ptr<Value>>> getParameters();
+
+    // Copy of member `member` as a standalone network
+    MultiLayerPerceptron getMember(size_t member);
+
+    // Functor; `input` is either getNIn() floats shared by all members or getNIn() per
+    // member, and the result holds getNOut() per member. Per-member losses come from
+    // `result->mse(target, getMembers())`, and backward() from their sum.
+    Value* operator()(Value &input, Value *output = nullptr);
+
+    // Gradient descent update with one learning rate for all members, or one each
+    void step(float learningRate);
+    void step(const std::vector<float> &learningRates);
+
+private:
+    struct StackedLayer {
+        size_t nIn;
+        size_t nOut;
+        Activation activation;
+        std::shared_ptr<Value> weights;
+        std::shared_ptr<Value> bias;
+    };
+
+    size_t mMembers;
+    std::vector<StackedLayer> mLayers;
+};
@@ -0,0 +1,402 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Value.h"
+
+// Opt-in fused elementwise arithmetic. Once one operand is an expression, operators
+// build a compile-time tree instead of one graph node per op, and evaluate() computes
+// the whole tree in a single loop into a single result Value:
+//
+//     Value* d = Expression::evaluate(Expression::leaf(a) * b + c);
+//
+// The result's backward pass applies the chain rule through the whole tree in one
+// loop as well. Intermediate values only ever live in the nodes, one element at a
+// time: backward recomputes them rather than reading them from memory. Gradient
+// tangents for Hessian-vector products are propagated like those of the Value ops.
+// Operands must outlive the result, as with the Value operators.
+class Expression {
+public:
+    // Base of every node, used to recognise expressions at compile time. For element i,
+    // forward(i) computes and keeps each node's value; tangent(i) and backward(i, grad),
+    // or backward(i, grad, gradTangent) in forward-over-reverse, then reuse those values.
+    template<typename Derived>
+    struct Node {
+    };
+
+    // A Value operand
+    class Leaf : public Node<Leaf> {
+    public:
+        explicit Leaf(Value &value) : mValue(&value) {}
+
+        size_t size() const { return mValue->mSize; }
+        void collect(std::vector<Value *> &refs) const { refs.push_back(mValue); }
+
+        // Fetch buffers just before a pass, since they are allocated lazily
+        void bind(bool grads, bool gradTangents = false) {
+            mData = mValue->mData;
+            mTangent = mValue->tangentData();
+            mGrad = grads && mValue->mRequiresGrad ? mValue->gradBuffer() : nullptr;
+            mGradTangent = gradTangents && mValue->mRequiresGrad ? mValue->gradTangentBuffer() : nullptr;
+        }
+
+        float forward(size_t i) {
+            mOutput = mData[i];
+            return mOutput;
+        }
+
+        float output() const { return mOutput; }
+        bool hasTangent() const { return mTangent != nullptr; }
+        float tangent(size_t i) const { return mTangent ? mTangent[i] : 0.0f; }
+
+        void backward(size_t i, float grad) const {
+            if (mGrad) {
+                mGrad[i] += grad;
+            }
+        }
+
+        void backward(size_t i, float grad, float gradTangent) const {
+            if (mGrad) {
+                mGrad[i] += grad;
+                mGradTangent[i] += gradTangent;
+            }
+        }
+
+    private:
+        Value *mValue;
+        const float *mData = nullptr;
+        const float *mTangent = nullptr;
+        float *mGrad = nullptr;
+        float *mGradTangent = nullptr;
+        float mOutput = 0.0f;
+    };
+
+    // A constant broadcast over every element
+    class Scalar : public Node<Scalar> {
+    public:
+        Scalar(float value) : mValue(value) {}
+
+        size_t size() const { return 0; }
+        void collect(std::vector<Value *> &) const {}
+        void bind(bool, bool = false) {}
+
+        float forward(size_t) const { return mValue; }
+        float output() const { return mValue; }
+        bool hasTangent() const { return false; }
+        float tangent(size_t) const { return 0.0f; }
+        void backward(size_t, float) const {}
+        void backward(size_t, float, float) const {}
+
+    private:
+        float mValue;
+    };
+
+    template<typename Op, typename Operand>
+    class Unary : public Node<Unary<Op, Operand>> {
+    public:
+        explicit Unary(Operand operand) : mOperand(std::move(operand)) {}
+
+        size_t size() const { return mOperand.size(); }
+        void collect(std::vector<Value *> &refs) const { mOperand.collect(refs); }
+        void bind(bool grads, bool gradTangents = false) { mOperand.bind(grads, gradTangents); }
+
+        float forward(size_t i) {
+            mOutput = Op::value(mOperand.forward(i));
+            return mOutput;
+        }
+
+        float output() const { return mOutput; }
+        bool hasTangent() const { return mOperand.hasTangent(); }
+
+        float tangent(size_t i) const {
+            return Op::derivative(mOperand.output(), mOutput) * mOperand.tangent(i);
+        }
+
+        void backward(size_t i, float grad) const {
+            mOperand.backward(i, grad * Op::derivative(mOperand.output(), mOutput));
+        }
+
+        void backward(size_t i, float grad, float gradTangent) const {
+            float derivative = Op::derivative(mOperand.output(), mOutput);
+            float second = Op::second(mOperand.output(), mOutput);
+            mOperand.backward(i, grad * derivative, gradTangent * derivative + grad * second * mOperand.tangent(i));
+        }
+
+    private:
+        Operand mOperand;
+        float mOutput = 0.0f;
+    };
+
+    template<typename Op, typename Left, typename Right>
+    class Binary : public Node<Binary<Op, Left, Right>> {
+    public:
+        Binary(Left left, Right right) : mLeft(std::move(left)), mRight(std::move(right)) {
+            // Scalars have size 0 and match anything
+            if (mLeft.size() && mRight.size() && mLeft.size() != mRight.size()) {
+                throw std::logic_error("size mismatch");
+            }
+        }
+
+        size_t size() const { return std::max(mLeft.size(), mRight.size()); }
+
+        void collect(std::vector<Value *> &refs) const {
+            mLeft.collect(refs);
+            mRight.collect(refs);
+        }
+
+        void bind(bool grads, bool gradTangents = false) {
+            mLeft.bind(grads, gradTangents);
+            mRight.bind(grads, gradTangents);
+        }
+
+        float forward(size_t i) {
+            float l = mLeft.forward(i);
+            mOutput = Op::value(l, mRight.forward(i));
+            return mOutput;
+        }
+
+        float output() const { return mOutput; }
+        bool hasTangent() const { return mLeft.hasTangent() || mRight.hasTangent(); }
+
+        float tangent(size_t i) const {
+            float l = mLeft.output();
+            float r = mRight.output();
+            return Op::left(l, r) * mLeft.tangent(i) + Op::right(l, r) * mRight.tangent(i);
+        }
+
+        void backward(size_t i, float grad) const {
+            float l = mLeft.output();
+            float r = mRight.output();
+            mLeft.backward(i, grad * Op::left(l, r));
+            mRight.backward(i, grad * Op::right(l, r));
+        }
+
+        void backward(size_t i, float grad, float gradTangent) const {
+            float l = mLeft.output();
+            float r = mRight.output();
+            float tl = mLeft.tangent(i);
+            float tr = mRight.tangent(i);
+            mLeft.backward(i, grad * Op::left(l, r),
+                           gradTangent * Op::left(l, r) + grad * (Op::leftLeft(l, r) * tl + Op::leftRight(l, r) * tr));
+            mRight.backward(i, grad * Op::right(l, r),
+                            gradTangent * Op::right(l, r) + grad * (Op::leftRight(l, r) * tl + Op::rightRight(l, r) * tr));
+        }
+
+    private:
+        Left mLeft;
+        Right mRight;
+        float mOutput = 0.0f;
+    };
+
+    // Binary ops: value, partial derivatives with respect to each side, and second
+    // partial derivatives
+    struct Add {
+        static float value(float l, float r) { return l + r; }
+        static float left(float, float) { return 1.0f; }
+        static float right(float, float) { return 1.0f; }
+        static float leftLeft(float, float) { return 0.0f; }
+        static float leftRight(float, float) { return 0.0f; }
+        static float rightRight(float, float) { return 0.0f; }
+    };
+
+    struct Subtract {
+        static float value(float l, float r) { return l - r; }
+        static float left(float, float) { return 1.0f; }
+        static float right(float, float) { return -1.0f; }
+        static float leftLeft(float, float) { return 0.0f; }
+        static float leftRight(float, float) { return 0.0f; }
+        static float rightRight(float, float) { return 0.0f; }
+    };
+
+    struct Multiply {
+        static float value(float l, float r) { return l * r; }
+        static float left(float, float r) { return r; }
+        static float right(float l, float) { return l; }
+        static float leftLeft(float, float) { return 0.0f; }
+        static float leftRight(float, float) { return 1.0f; }
+        static float rightRight(float, float) { return 0.0f; }
+    };
+
+    struct Divide {
+        static float value(float l, float r) { return l / r; }
+        static float left(float, float r) { return 1.0f / r; }
+        static float right(float l, float r) { return -l / (r * r); }
+        static float leftLeft(float, float) { return 0.0f; }
+        static float leftRight(float, float r) { return -1.0f / (r * r); }
+        static float rightRight(float l, float r) { return 2.0f * l / (r * r * r); }
+    };
+
+    // Unary ops: value, and first and second derivatives given the input x and the output y
+    struct Negate {
+        static float value(float x) { return -x; }
+        static float derivative(float, float) { return -1.0f; }
+        static float second(float, float) { return 0.0f; }
+    };
+
+    struct Exp {
+        static float value(float x) { return std::exp(x); }
+        static float derivative(float, float y) { return y; }
+        static float second(float, float y) { return y; }
+    };
+
+    struct Tanh {
+        static float value(float x) { return std::tanh(x); }
+        static float derivative(float, float y) { return 1.0f - y * y; }
+        static float second(float, float y) { return -2.0f * y * (1.0f - y * y); }
+    };
+
+    struct ReLU {
+        static float value(float x) { return std::max(x, 0.0f); }
+        static float derivative(float x, float) { return x > 0.0f ? 1.0f : 0.0f; }
+        static float second(float, float) { return 0.0f; }
+    };
+
+    struct Sigmoid {
+        static float value(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+        static float derivative(float, float y) { return y * (1.0f - y); }
+        static float second(float, float y) { return y * (1.0f - y) * (1.0f - 2.0f * y); }
+    };
+
+    // Node type standing for an operand: expressions as they are, Value lvalues as
+    // leaves and numbers as scalars
+    template<typename T, typename = void>
+    struct Operand {
+    };
+
+    template<typename T>
+    struct Operand<T, std::enable_if_t<std::is_base_of<Node<std::decay_t<T>>, std::decay_t<T>>::value>> {
+        using type = std::decay_t<T>;
+    };
+
+    template<typename T>
+    struct Operand<T, std::enable_if_t<std::is_lvalue_reference<T>::value &&
+                                       std::is_same<std::decay_t<T>, Value>::value>> {
+        using type = Leaf;
+    };
+
+    template<typename T>
+    struct Operand<T, std::enable_if_t<std::is_arithmetic<std::decay_t<T>>::value>> {
+        using type = Scalar;
+    };
+
+    template<typename T>
+    static constexpr bool isNode = std::is_base_of<Node<std::decay_t<T>>, std::decay_t<T>>::value;
+
+    // Starts an expression from a Value
+    static Leaf leaf(Value &value) {
+        return Leaf(value);
+    }
+
+    template<typename E, typename = std::enable_if_t<isNode<E>>>
+    static Unary<Exp, std::decay_t<E>> exp(E &&operand) {
+        return Unary<Exp, std::decay_t<E>>(std::forward<E>(operand));
+    }
+
+    template<typename E, typename = std::enable_if_t<isNode<E>>>
+    static Unary<Tanh, std::decay_t<E>> tanh(E &&operand) {
+        return Unary<Tanh, std::decay_t<E>>(std::forward<E>(operand));
+    }
+
+    template<typename E, typename = std::enable_if_t<isNode<E>>>
+    static Unary<ReLU, std::decay_t<E>> relu(E &&operand) {
+        return Unary<ReLU, std::decay_t<E>>(std::forward<E>(operand));
+    }
+
+    template<typename E, typename = std::enable_if_t<isNode<E>>>
+    static Unary<Sigmoid, std::decay_t<E>> sigmoid(E &&operand) {
+        return Unary<Sigmoid, std::decay_t<E>>(std::forward<E>(operand));
+    }
+
+    // Computes `expression` into a new Value, or into `out` (see Value::outputSlice())
+    template<typename E, typename = std::enable_if_t<isNode<E>>>
+    static Value *evaluate(const E &expression, Value *out = nullptr) {
+        size_t size = expression.size();
+        if (size == 0) {
+            throw std::logic_error("expression has no Value operand");
+        }
+
+        std::vector<Value *> refs;
+        expression.collect(refs);
+        auto result = Value::makeResult(out, size, refs);
+
+        auto fused = expression;
+        result->setBackward([result, fused, size]() mutable {
+            auto resultGrad = result->gradBuffer();
+            fused.bind(true);
+
+            // Forward-over-reverse: tangent of the gradient
+            auto resultGradTangent = result->gradTangentData();
+            if (resultGradTangent || fused.hasTangent()) {
+                fused.bind(true, true);
+                for (size_t i = 0; i < size; ++i) {
+                    fused.forward(i);
+                    fused.backward(i, resultGrad[i], resultGradTangent ? resultGradTangent[i] : 0.0f);
+                }
+                return;
+            }
+
+            for (size_t i = 0; i < size; ++i) {
+                fused.forward(i);
+                fused.backward(i, resultGrad[i]);
+            }
+        });
+
+        fused.bind(false);
+        if (!fused.hasTangent()) {
+            for (size_t i = 0; i < size; ++i) {
+                result->mData[i] = fused.forward(i);
+            }
+        } else {
+            // Forward-mode tangent, in the same pass
+            auto resultTangent = result->tangentBuffer();
+            for (size_t i = 0; i < size; ++i) {
+                result->mData[i] = fused.forward(i);
+                resultTangent[i] = fused.tangent(i);
+            }
+        }
+
+        return result;
+    }
+};
+
+// Operators on expressions; at least one side must already be an expression node
+template<typename L, typename R,
+        typename = std::enable_if_t<Expression::isNode<L> || Expression::isNode<R>>>
+Expression::Binary<Expression::Add, typename Expression::Operand<L>::type, typename Expression::Operand<R>::type>
+operator+(L &&left, R &&right) {
+    return {typename Expression::Operand<L>::type(std::forward<L>(left)),
+            typename Expression::Operand<R>::type(std::forward<R>(right))};
+}
+
+template<typename L, typename R,
+        typename = std::enable_if_t<Expression::isNode<L> || Expression::isNode<R>>>
+Expression::Binary<Expression::Subtract, typename Expression::Operand<L>::type, typename Expression::Operand<R>::type>
+operator-(L &&left, R &&right) {
+    return {typename Expression::Operand<L>::type(std::forward<L>(left)),
+            typename Expression::Operand<R>::type(std::forward<R>(right))};
+}
+
+template<typename L, typename R,
+        typename = std::enable_if_t<Expression::isNode<L> || Expression::isNode<R>>>
+Expression::Binary<Expression::Multiply, typename Expression::Operand<L>::type, typename Expression::Operand<R>::type>
+operator*(L &&left, R &&right) {
+    return {typename Expression::Operand<L>::type(std::forward<L>(left)),
+            typename Expression::Operand<R>::type(std::forward<R>(right))};
+}
+
+template<typename L, typename R,
+        typename = std::enable_if_t<Expression::isNode<L> || Expression::isNode<R>>>
+Expression::Binary<Expression::Divide, typename Expression::Operand<L>::type, typename Expression::Operand<R>::type>
+operator/(L &&left, R &&right) {
+    return {typename Expression::Operand<L>::type(std::forward<L>(left)),
+            typename Expression::Operand<R>::type(std::forward<R>(right))};
+}
+
+template<typename E, typename = std::enable_if_t<Expression::isNode<E>>>
+Expression::Unary<Expression::Negate, std::decay_t<E>> operator-(E &&operand) {
+    return Expression::Unary<Expression::Negate, std::decay_t<E>>(std::forward<E>(operand));
+}
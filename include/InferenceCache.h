@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "MultiLayerPerceptron.h"
+
+// Memoises inference for inputs seen recently. Entries are keyed by a hash of the input
+// data, checked against a stored copy of it, and kept in per-shard LRU lists whose
+// combined size stays within a byte budget. Each shard remembers the parameter version
+// (see Value::getVersion()) its entries were computed with and drops them all once any
+// parameter of the model has been written since. Code that writes parameters through
+// a span or the subscript must call markModified() afterwards for the cache to notice.
+class InferenceCache {
+public:
+    struct Options {
+        size_t shards = 16;
+        // Inputs, outputs and bookkeeping of every entry together
+        size_t maxBytes = 64 * 1024 * 1024;
+    };
+
+    // Constructors; the model must outlive the cache and keep its architecture
+    explicit InferenceCache(MultiLayerPerceptron &model);
+    InferenceCache(MultiLayerPerceptron &model, const Options &options);
+
+    // Like the model's operator(), except that the result records no graph.
+    // Safe to call from several threads.
+    Value* operator()(Value &input, Value *output = nullptr);
+
+    // Counters since construction
+    size_t getHits() const;
+    size_t getMisses() const;
+    size_t getEvictions() const;
+    // Entries dropped because the parameters changed
+    size_t getInvalidations() const;
+
+    size_t getBytes() const;
+    size_t getEntries() const;
+
+    void clear();
+
+private:
+    struct Entry {
+        uint64_t hash;
+        std::vector<float> input;
+        std::vector<float> output;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        // Most recently used first
+        std::list<Entry> entries;
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+        size_t version = 0;
+    };
+
+    // Sum of the parameters' versions
+    size_t getParameterVersion() const;
+
+    Shard &shardOf(uint64_t hash);
+
+    // Drop the shard's entries if they predate `version`; the shard's mutex must be held
+    void invalidate(Shard &shard, size_t version);
+
+    static size_t sizeOf(const Entry &entry);
+
+    MultiLayerPerceptron &mModel;
+    std::shared_ptr<std::vector<std::shared_ptr<Value>>> mParameters;
+    std::vector<std::unique_ptr<Shard>> mShards;
+    size_t mShardBytes;
+
+    std::atomic<size_t> mHits{0};
+    std::atomic<size_t> mMisses{0};
+    std::atomic<size_t> mEvictions{0};
+    std::atomic<size_t> mInvalidations{0};
+    std::atomic<size_t> mBytes{0};
+    std::atomic<size_t> mEntries{0};
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "Curvature.h"
+
+// Limited-memory BFGS over a flattened parameter list. Each step builds a quasi-Newton
+// direction from the last `history` (s, y) pairs by the two-loop recursion and takes a
+// backtracking line search along it. The objective must be full batch, and the
+// parameters should only change through step() in between.
+class LBFGS {
+public:
+    // Constructors
+    explicit LBFGS(std::shared_ptr<Curvature::Parameters> parameters, size_t history = 10);
+
+    // One iteration; returns the loss before the update
+    float step(const Curvature::Objective &objective);
+
+private:
+    std::shared_ptr<Curvature::Parameters> mParameters;
+    size_t mHistory;
+    std::deque<std::vector<float>> mS;
+    std::deque<std::vector<float>> mY;
+    // Gradient and loss at the current parameters, carried over from the last line search
+    std::vector<float> mGradient;
+    float mLoss = 0.0f;
+    // First step the line search tries, relative to the direction; shrinks after a failure
+    float mStep = 1.0f;
+};
@@ -6,16 +6,28 @@
 class Layer {
 public:
     // Constructors
-    Layer(size_t nIn, size_t nOut);
+    Layer(size_t nIn, size_t nOut, Activation activation = Activation::Tanh);
 
     // Parameters
     std::shared_ptr<std::vector<std::shared_ptr<Value>>> getParameters();
 
-    // Functor
-    Value* operator()(Value &input);
+    // Shape
+    size_t getNIn() const;
+    size_t getNOut() const;
+    Activation getActivation() const;
+
+    // Functor; `output` optionally supplies the destination buffer for the result
+    Value* operator()(Value &input, Value *output = nullptr);
+
+    // Sparse input; forward and backward only touch the weight columns of its nonzeros
+    Value* operator()(SparseValue &input, Value *output = nullptr);
 
 private:
+    template <typename Input>
+    Value* forward(Input &input, Value *output);
+
     size_t mNIn;
     size_t mNOut;
+    Activation mActivation;
     std::vector<std::shared_ptr<Neuron>> mNeurons;
 };
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file, hinted for sequential access
+class MappedFile {
+public:
+    // Constructors
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char *getData() const;
+    size_t getSize() const;
+
+    // Drop the pages of [0, offset) from this process, once they have been consumed
+    void release(size_t offset);
+
+private:
+    const char *mData = nullptr;
+    size_t mSize = 0;
+};
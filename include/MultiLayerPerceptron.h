@@ -1,6 +1,10 @@
 #pragma once
 
 #include <cstddef>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
 #include "Neuron.h"
 #include "Layer.h"
 
@@ -8,12 +12,32 @@ class MultiLayerPerceptron {
 public:
     // Constructors
     MultiLayerPerceptron(size_t nIn, std::vector<size_t> nOuts);
+    MultiLayerPerceptron(size_t nIn, std::vector<size_t> nOuts, std::vector<Activation> activations);
 
     // Parameters
     std::shared_ptr<std::vector<std::shared_ptr<Value>>> getParameters();
+    const std::vector<std::shared_ptr<Layer>> &getLayers() const;
 
-    // Functor
-    Value* operator()(Value &input);
+    // Binary model file: architecture followed by the parameters in getParameters() order
+    void save(std::ostream &os);
+    static MultiLayerPerceptron load(std::istream &is);
+
+    // Write a self-contained C++ header evaluating this network with its current weights.
+    // It defines `name(const float (&)[nIn], float (&)[nOut])` and needs nothing beyond <cmath>.
+    void generateHeader(std::ostream &os, const std::string &name);
+
+    // d output / d input, one row per output, by forward-mode passes without recording a graph
+    std::vector<std::vector<float>> jacobian(Value &input);
+
+    // H v for the loss built by `objective`, with respect to getParameters() flattened in
+    // order, by forward-over-reverse; see Curvature
+    std::vector<float> hessianVectorProduct(const std::function<Value*()> &objective, const std::vector<float> &v);
+
+    // Functor; `output` optionally supplies the destination buffer for the result
+    Value* operator()(Value &input, Value *output = nullptr);
+
+    // Sparse input, consumed by the first layer's sparse kernel
+    Value* operator()(SparseValue &input, Value *output = nullptr);
 private:
     std::vector<std::shared_ptr<Layer>> mLayers;
 };
\ No newline at end of file
@@ -1,21 +1,56 @@
 #pragma once
 
+#include <cmath>
 #include <cstddef>
+#include <stdexcept>
 #include "Value.h"
 
+// Nonlinearity applied to a neuron's output
+enum class Activation {
+    Tanh,
+    ReLU,
+    GELU,
+    Sigmoid
+};
+
+// Scalar formula of each activation in terms of `x`. activate() compiles them and
+// MultiLayerPerceptron::generateHeader() emits them as source, so the two always agree.
+#define SMOLGRAD_ACTIVATIONS(X) \
+    X(Tanh, std::tanh(x)) \
+    X(ReLU, x > 0.0f ? x : 0.0f) \
+    X(GELU, 0.5f * x * (1.0f + std::tanh(0.7978845608f * (x + 0.044715f * x * x * x)))) \
+    X(Sigmoid, 1.0f / (1.0f + std::exp(-x)))
+
+// Activation of one pre-activation, for kernels working on raw floats
+inline float activate(Activation activation, float x) {
+    switch (activation) {
+#define SMOLGRAD_ACTIVATION_CASE(name, formula) \
+        case Activation::name: \
+            return formula;
+        SMOLGRAD_ACTIVATIONS(SMOLGRAD_ACTIVATION_CASE)
+#undef SMOLGRAD_ACTIVATION_CASE
+    }
+    throw std::logic_error("unknown activation");
+}
+
+// Apply the activation to the pre-activation `d` as a graph op, writing into `output` if given
+Value* activate(Value *d, Activation activation, Value *output = nullptr);
+
 class Neuron {
 public:
     // Constructors
-    Neuron(size_t nIn);
+    Neuron(size_t nIn, Activation activation = Activation::Tanh);
 
     // Parameters
     std::shared_ptr<std::vector<std::shared_ptr<Value>>> getParameters();
 
-    // Functor
-    Value* operator()(Value &input);
+    // Functor; `output` optionally supplies the destination buffer for the result
+    Value* operator()(Value &input, Value *output = nullptr);
+    Value* operator()(SparseValue &input, Value *output = nullptr);
 
 private:
     size_t mNIn;
+    Activation mActivation;
     std::shared_ptr<Value> mWeight;
     std::shared_ptr<Value> mBias;
 };
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "Curvature.h"
+
+// Truncated Newton over a flattened parameter list. Each step solves (H + damping I) p = -g
+// approximately by conjugate gradients, using Hessian-vector products only, then takes
+// a backtracking line search along p. Conjugate gradients stop early on negative
+// curvature, falling back to steepest descent if that happens straight away.
+class NewtonCG {
+public:
+    // Constructors
+    explicit NewtonCG(std::shared_ptr<Curvature::Parameters> parameters, size_t maxIterations = 10,
+                      float damping = 1e-4f);
+
+    // One iteration; returns the loss before the update
+    float step(const Curvature::Objective &objective);
+
+private:
+    std::shared_ptr<Curvature::Parameters> mParameters;
+    size_t mMaxIterations;
+    float mDamping;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "MultiLayerPerceptron.h"
+
+// Magnitude pruning of a MultiLayerPerceptron's weights (biases are kept). Pruned
+// weights are zeroed and remembered, so training can continue under a fixed mask
+// by calling applyMask() after each update.
+class Pruner {
+public:
+    // Constructors
+    explicit Pruner(MultiLayerPerceptron &model);
+
+    // Zero the smallest-magnitude weights until `sparsity` of all weights are pruned
+    void pruneGlobal(float sparsity);
+
+    // As pruneGlobal, with a separate target for each layer
+    void pruneLayers(const std::vector<float> &sparsities);
+
+    // Re-zero every pruned weight, e.g. after a fine-tuning step
+    void applyMask();
+
+    // Fraction of weights currently pruned
+    float getSparsity() const;
+
+private:
+    struct Mask {
+        std::shared_ptr<Value> weight;
+        std::vector<bool> pruned;
+        size_t layer;
+    };
+
+    // Prune the smallest weights among the masks selected by `layer` (all layers when null)
+    void prune(float sparsity, const size_t *layer);
+
+    std::vector<Mask> mMasks;
+    size_t mLayers;
+};
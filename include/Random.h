@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "Span.h"
+
+// Counter-based random numbers (Philox4x32-10). Every element is a pure function of
+// (seed, stream, index), so buffers are filled in parallel with identical results
+// regardless of how the work is split between threads.
+class Random {
+public:
+    // Global seed; resets the stream counter so subsequent fills repeat exactly
+    static void seed(uint64_t seed);
+
+    // Worker threads used for large fills, 0 for one per hardware thread
+    static void setThreads(size_t threads);
+
+    // Fill from the next stream of the global seed
+    static void uniform(Span<float> out, float min, float max);
+    static void normal(Span<float> out, float mean, float stddev);
+
+    // Fill from an explicit seed and stream
+    static void uniform(Span<float> out, float min, float max, uint64_t seed, uint64_t stream, size_t threads);
+    static void normal(Span<float> out, float mean, float stddev, uint64_t seed, uint64_t stream, size_t threads);
+
+    // Four random words for one counter block
+    static std::array<uint32_t, 4> philox(uint64_t counter, uint64_t stream, uint64_t key);
+
+private:
+    static uint64_t sSeed;
+    static std::atomic<uint64_t> sStream;
+    static size_t sThreads;
+};
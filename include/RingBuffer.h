@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded single-producer single-consumer queue. Neither side ever blocks or locks:
+// push() fails when the buffer is full and pop() fails when it is empty.
+template<typename T, size_t Capacity>
+class RingBuffer {
+public:
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    bool push(const T &item) {
+        size_t head = mHead.load(std::memory_order_relaxed);
+        if (head - mTail.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        mItems[head & (Capacity - 1)] = item;
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item) {
+        size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail == mHead.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = mItems[tail & (Capacity - 1)];
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> mItems;
+    // Producer and consumer counters on separate cache lines
+    alignas(64) std::atomic<size_t> mHead{0};
+    alignas(64) std::atomic<size_t> mTail{0};
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "Transport.h"
+
+// Transport between processes on one host through a POSIX shared memory segment
+// holding one single-producer, single-consumer ring buffer per ordered pair of ranks.
+// Every rank opens the same segment by name; it is unlinked once all ranks have
+// mapped it, so the name only needs to be unique while the job starts up.
+class SharedMemoryTransport : public Transport {
+public:
+    // Constructors
+    SharedMemoryTransport(const std::string &name, size_t rank, size_t worldSize);
+    ~SharedMemoryTransport() override;
+
+    SharedMemoryTransport(const SharedMemoryTransport &) = delete;
+    SharedMemoryTransport &operator=(const SharedMemoryTransport &) = delete;
+
+    size_t getRank() const override;
+    size_t getWorldSize() const override;
+
+    void send(size_t peer, const float *data, size_t size) override;
+    void receive(size_t peer, float *data, size_t size) override;
+
+private:
+    struct Channel;
+
+    Channel *channel(size_t from, size_t to);
+
+    size_t mRank;
+    size_t mWorldSize;
+    void *mMapping;
+    size_t mMappingSize;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+// Non-owning view over a contiguous range of elements
+template <typename T>
+class Span {
+public:
+    // Constructors
+    Span() : mData(nullptr), mSize(0) {}
+    Span(T *data, size_t size) : mData(data), mSize(size) {}
+
+    // A mutable span reads as a const one
+    template <typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+    Span(const Span<U> &other) : mData(other.data()), mSize(other.size()) {}
+
+    // Subscript operator
+    T& operator[](size_t index) const { return mData[index]; }
+
+    // Member function
+    T* data() const { return mData; }
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    // Iterators
+    T* begin() const { return mData; }
+    T* end() const { return mData + mSize; }
+
+private:
+    T *mData;
+    size_t mSize;
+};
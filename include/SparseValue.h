@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Value.h"
+
+// Sparse vector of a given dense size as (index, value) pairs, for inputs such as
+// one-hot or bag-of-words features. Used as a constant input; it takes no gradient.
+class SparseValue {
+public:
+    // Factory methods
+    static SparseValue fromDense(const Value &value);
+
+    // Constructor
+    SparseValue(size_t size, std::vector<size_t> indices, std::vector<float> values);
+
+    // Member function
+    size_t getSize() const;
+    size_t getNonZeros() const;
+    const std::vector<size_t> &getIndices() const;
+    const std::vector<float> &getValues() const;
+    Value toDense() const;
+
+private:
+    size_t mSize;
+    std::vector<size_t> mIndices;
+    std::vector<float> mValues;
+};
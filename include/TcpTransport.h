@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Transport.h"
+
+// Transport over a full mesh of TCP connections. Rank r listens on basePort + r at
+// hosts[r] (IPv4 addresses), connects to every lower rank and accepts every higher one.
+class TcpTransport : public Transport {
+public:
+    // Constructors
+    TcpTransport(size_t rank, std::vector<std::string> hosts, uint16_t basePort);
+    ~TcpTransport() override;
+
+    TcpTransport(const TcpTransport &) = delete;
+    TcpTransport &operator=(const TcpTransport &) = delete;
+
+    size_t getRank() const override;
+    size_t getWorldSize() const override;
+
+    void send(size_t peer, const float *data, size_t size) override;
+    void receive(size_t peer, float *data, size_t size) override;
+
+private:
+    size_t mRank;
+    std::vector<std::string> mHosts;
+    std::vector<int> mSockets;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RingBuffer.h"
+
+class Value;
+
+// Per-step training metrics. The training loop records a step into a lock-free ring
+// buffer; a background thread appends it to a rotating JSON-lines file and rewrites
+// a Prometheus text-format file with the latest values, for a scraper's textfile
+// collector. Steps recorded while the buffer is full are dropped and counted.
+class Telemetry {
+public:
+    struct Step {
+        size_t step = 0;
+        size_t samples = 0;
+        double forwardSeconds = 0.0;
+        double backwardSeconds = 0.0;
+        double optimizerSeconds = 0.0;
+        float loss = 0.0f;
+        float gradientNorm = 0.0f;
+        // Filled in by record()
+        size_t liveValues = 0;
+        size_t liveBytes = 0;
+    };
+
+    struct Options {
+        std::string jsonPath = "metrics.jsonl";
+        std::string prometheusPath = "metrics.prom";
+        // The JSON-lines file is rotated to jsonPath.1 ... jsonPath.<maxFiles> past this size
+        size_t maxFileBytes = 16 * 1024 * 1024;
+        size_t maxFiles = 3;
+        std::chrono::milliseconds flushInterval{100};
+    };
+
+    // Throws std::runtime_error when the JSON-lines file cannot be opened
+    explicit Telemetry(Options options);
+    ~Telemetry();
+
+    Telemetry(const Telemetry&) = delete;
+    Telemetry& operator=(const Telemetry&) = delete;
+
+    // Hot path: one queue push, never blocks. Steps must be recorded from a single thread.
+    void record(Step step);
+
+    // Blocks until everything recorded so far has been written
+    void flush();
+
+    size_t getDropped() const;
+
+    // L2 norm of the gradients of `parameters`
+    static float gradientNorm(const std::vector<std::shared_ptr<Value>> &parameters);
+
+    // Peak resident set size of this process
+    static size_t getPeakRss();
+
+    // Seconds elapsed since `start`
+    static double secondsSince(std::chrono::steady_clock::time_point start);
+
+private:
+    void run();
+    void write(const Step &step);
+    void writePrometheus(const Step &step);
+    void rotate();
+
+    Options mOptions;
+    RingBuffer<Step, 1024> mQueue;
+    std::atomic<size_t> mRecorded{0};
+    std::atomic<size_t> mWritten{0};
+    std::atomic<size_t> mDropped{0};
+    std::atomic<bool> mStopping{false};
+    std::ofstream mJson;
+    size_t mFileBytes = 0;
+    double mTotalSamples = 0.0;
+    std::thread mWriter;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Optional pinning of worker threads to CPUs, so threads stay next to the memory
+// they first touched. Worker i of any pool runs on cpus[i % cpus.size()]; with no
+// CPUs configured, pinning does nothing. Read on first use from SMOLGRAD_CPUS,
+// a list such as "0-7,16,18".
+class ThreadAffinity {
+public:
+    // Runtime configuration; safe while other threads are being pinned
+    static void setCpus(std::vector<size_t> cpus);
+    static std::vector<size_t> parseCpus(const std::string &list);
+
+    // Pin a pool's worker, or the calling thread
+    static void pin(std::thread &thread, size_t worker);
+    static void pinCurrent(size_t worker);
+
+private:
+    // The list in force; setCpus() replaces it rather than changing it in place
+    static std::shared_ptr<const std::vector<size_t>> cpus();
+};
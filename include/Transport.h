@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include "Span.h"
+
+// Point-to-point float messaging between the ranks of a training job, and the
+// collectives built on it. Implementations provide blocking send and receive.
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    // Rank of this process and number of ranks
+    virtual size_t getRank() const = 0;
+    virtual size_t getWorldSize() const = 0;
+
+    // Blocking point-to-point transfer
+    virtual void send(size_t peer, const float *data, size_t size) = 0;
+    virtual void receive(size_t peer, float *data, size_t size) = 0;
+
+    // Send to one peer while receiving from another, in pieces small enough that
+    // a ring of ranks all doing this at once cannot deadlock on full buffers
+    virtual void sendReceive(size_t sendPeer, const float *sendData, size_t sendSize,
+                             size_t receivePeer, float *receiveData, size_t receiveSize);
+
+    // Ring allreduce (reduce-scatter then allgather), leaving the mean over all ranks in `data`
+    void allReduce(Span<float> data);
+
+    // Blocks until every rank has reached the barrier
+    void barrier();
+
+protected:
+    static constexpr size_t kPieceSize = 4096;
+};
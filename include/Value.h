@@ -1,13 +1,29 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <optional>
 #include <vector>
+#include "Allocator.h"
+#include "Span.h"
+
+class SparseValue;
 
 class Value
 {
 public:
+    // While alive, ops on the constructing thread record no graph: results neither require
+    // gradients nor keep references. Other threads are unaffected.
+    class NoGrad {
+    public:
+        NoGrad();
+        ~NoGrad();
+
+    private:
+        bool mPrevious;
+    };
+
     // Factory methods
     static Value constant(size_t size, float value);
     static Value rand(size_t size, float min, float max);
@@ -27,8 +43,15 @@ public:
     // Copy constructor
     Value(const Value& other);
 
+    // Move constructor; like a copy, the result is a leaf outside any graph. The source
+    // is left empty: size 0, without data, gradient or tangent.
+    Value(Value&& other) noexcept;
+
     // Copy assignment operator
-    Value& operator=(Value other);
+    Value& operator=(const Value& other);
+
+    // Move assignment operator
+    Value& operator=(Value&& other) noexcept;
 
     // Subscript operator
     float& operator[](std::size_t index);
@@ -50,8 +73,12 @@ public:
     Value* operator/(float other);
 
     Value* pow(float exponent);
-    Value* exp();
-    Value* tanh();
+    // Elementwise functions; `out` optionally supplies the destination, see outputSlice()
+    Value* exp(Value* out = nullptr);
+    Value* tanh(Value* out = nullptr);
+    Value* relu(Value* out = nullptr);
+    Value* gelu(Value* out = nullptr);
+    Value* sigmoid(Value* out = nullptr);
 
     // Member function
     size_t getSize() const;
@@ -59,29 +86,157 @@ public:
     Value* getGrad();
     float at(size_t index) const;
 
+    // Non-owning accessors; the gradient span allocates the gradient buffer if needed
+    Span<float> getDataSpan();
+    Span<const float> getDataSpan() const;
+    Span<float> getGradSpan();
+
+    // Read-only gradient that leaves sparse gradients sparse: the dense part (empty when there
+    // is none) plus (index, value) pairs still to be added to it, where an index may repeat
+    Span<const float> getDenseGradSpan() const;
+    std::vector<std::pair<size_t, float>> getSparseGrad() const;
+
+    // Forward-mode differentiation: when any input carries a tangent, every op also
+    // computes the directional derivative of its result. Views share tangents.
+    bool hasTangent() const;
+    Span<float> getTangentSpan();
+    void clearTangent();
+
+    // Forward-over-reverse: when tangents were present during the forward pass, backward()
+    // also propagates the tangent of every gradient. Seeding parameter tangents with v
+    // therefore leaves the Hessian-vector product H v in their gradient tangents.
+    bool hasGradTangent() const;
+    Span<float> getGradTangentSpan();
+
+    // View of a contiguous range sharing this value's data and gradient
+    Value* slice(size_t offset, size_t size);
+
+    // Unattached range of this value's buffer, for an op to write its result into.
+    // Concatenating adjacent output slices is then free of copies.
+    Value* outputSlice(size_t offset, size_t size);
+
+    // Gradient tracking; gradient buffers are only allocated once backward() reaches a node
+    bool getRequiresGrad() const;
+    void setRequiresGrad(bool requiresGrad);
+    bool hasGrad() const;
+
     // Set backward function
     void setBackward(std::function<void()> backward);
 
-    // Backward pass
+    // Backward pass; `onLeafReady` is called for each leaf as soon as its gradient is final
     void backward();
+    void backward(const std::function<void(Value*)> &onLeafReady);
+
+    // Gradient descent update; when only sparse gradients were accumulated it costs
+    // time proportional to their number rather than to the size of this value
+    void step(float learningRate);
 
     // Clear gradient
     void clearGrad();
+    static void clearGrads();
+
+    // Number of Values currently alive, graph nodes included
+    static size_t getLiveCount();
+
+    // Counts writes: step(), += and -= and assignment count themselves, while code writing
+    // through the subscript or a data span calls markModified() once it has finished.
+    // Shared by views; never decreases for a given Value, even when assignment replaces
+    // its storage.
+    size_t getVersion() const;
+    void markModified();
 
     // Sum
     Value* sum();
 
     // Dot product
     Value *dot(Value &other);
+    Value *dot(SparseValue &other);
+
+    // `groups` independent affine maps in one node: group k maps its slice of this value
+    // (or all of it, when this holds a single input shared by every group) through its own
+    // [nOut][nIn] row-major block of `weights` plus its slice of `bias`
+    Value *stackedAffine(Value &weights, Value &bias, size_t groups, Value *out = nullptr);
+
+    // Losses against a target of the same size, each a single node with a closed-form backward
+    Value *mse(Value &target);
+    // One mean per each of `groups` equal slices; the target may be a single slice shared by all
+    Value *mse(Value &target, size_t groups);
+    Value *softmaxCrossEntropy(Value &target);
 
     // << operator
     friend std::ostream& operator<<(std::ostream& os, const Value& value);
 
 private:
+    // Fused expressions build their results like the ops below
+    friend class Expression;
+
+    // Buffers shared between a value and its views
+    struct Storage {
+        explicit Storage(size_t size);
+
+        Allocator::Buffer data;
+        Allocator::Buffer grad;
+        Allocator::Buffer tangent;
+        Allocator::Buffer gradTangent;
+        std::vector<std::pair<size_t, float>> sparseGrad;
+        size_t size;
+        size_t gradGeneration = 0;
+        size_t sparseGradGeneration = 0;
+        size_t gradTangentGeneration = 0;
+        // Only bumped by whoever is writing the data, so a load and store suffice
+        std::atomic<size_t> version{0};
+    };
+
+    // View constructor
+    Value(Value& parent, size_t offset, size_t size);
+
+    // Result node of an op, either newly allocated or written into `out`
+    static Value* makeResult(Value* out, size_t size, std::initializer_list<Value*> refs);
+    static Value* makeResult(Value* out, size_t size, std::vector<Value*> &refs);
+
+    // Record inputs, honouring the gradient mode
+    void setReferences(std::vector<Value*> refs);
+
+    // Tangent for reading (null when absent) and for writing (allocated zeroed on demand)
+    const float* tangentData() const;
+    float* tangentBuffer();
+
+    // Gradient tangent for reading (null when absent) and for accumulation
+    const float* gradTangentData() const;
+    float* gradTangentBuffer();
+
+    // Gradient buffer for accumulation, allocated and zeroed on demand
+    float* gradBuffer();
+
+    // Gradients may also be held as (index, value) pairs until something needs them dense
+    bool hasDenseGrad() const;
+    bool hasSparseGrad() const;
+    void accumulateSparseGrad(size_t index, float grad);
+    void addGradTo(float* out) const;
+
+    // Bumped by clearGrads() to invalidate every gradient at once
+    static size_t sGradGeneration;
+
+    // Cleared by NoGrad, per thread
+    static thread_local bool sGradEnabled;
+
+    // Counts live Values whichever constructor made them
+    struct Census {
+        Census();
+        Census(const Census&);
+        Census& operator=(const Census&) = default;
+        ~Census();
+    };
+
+    static std::atomic<size_t> sLiveCount;
+
     // Member variable
+    std::shared_ptr<Storage> mStorage;
+    float* mData;
     size_t mSize;
-    std::unique_ptr<float[]> mGrad;
-    std::unique_ptr<float[]> mData;
+    size_t mOffset = 0;
     std::vector<Value*> mReferences;
     std::function<void()> mBackward;
+    bool mRequiresGrad = true;
+    Census mCensus;
 };
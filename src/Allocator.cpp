@@ -0,0 +1,142 @@
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include "Allocator.h"
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+    // Width of the node mask passed to mbind
+    constexpr int kMaxNodes = 256;
+}
+
+// Read on every allocation, so loads are lock-free; the setters serialise on the mutex
+struct Allocator::Settings {
+    std::atomic<HugePages> hugePages{HugePages::Transparent};
+    std::atomic<Placement> placement{Placement::Local};
+    std::atomic<int> node{0};
+    std::atomic<size_t> threshold{kHugePageSize};
+    std::mutex mutex;
+
+    Settings() {
+        if (auto value = std::getenv("SMOLGRAD_HUGE_PAGES")) {
+            std::string mode(value);
+            hugePages = mode == "off" ? HugePages::Off : mode == "explicit" ? HugePages::Explicit : HugePages::Transparent;
+        }
+        if (auto value = std::getenv("SMOLGRAD_NUMA")) {
+            std::string mode(value);
+            if (mode == "interleave") {
+                placement = Placement::Interleave;
+            } else if (mode != "local") {
+                // Anything but a valid node number keeps the default
+                char *end = nullptr;
+                long parsed = std::strtol(value, &end, 10);
+                if (end != value && *end == '\0' && parsed >= 0 && parsed < kMaxNodes) {
+                    placement = Placement::Node;
+                    node = static_cast<int>(parsed);
+                }
+            }
+        }
+    }
+};
+
+std::atomic<size_t> Allocator::sLiveBytes{0};
+
+size_t Allocator::getLiveBytes() {
+    return sLiveBytes.load(std::memory_order_relaxed);
+}
+
+Allocator::Settings &Allocator::settings() {
+    static Settings settings;
+    return settings;
+}
+
+void Allocator::setHugePages(HugePages hugePages) {
+    std::lock_guard<std::mutex> lock(settings().mutex);
+    settings().hugePages.store(hugePages, std::memory_order_relaxed);
+}
+
+void Allocator::setPlacement(Placement placement, int node) {
+    if (node < 0 || node >= kMaxNodes) {
+        throw std::out_of_range("NUMA node out of range");
+    }
+    std::lock_guard<std::mutex> lock(settings().mutex);
+    // Node first, so an allocation that sees the new placement never pairs it with a stale node
+    settings().node.store(node, std::memory_order_relaxed);
+    settings().placement.store(placement, std::memory_order_release);
+}
+
+void Allocator::setMappingThreshold(size_t bytes) {
+    std::lock_guard<std::mutex> lock(settings().mutex);
+    settings().threshold.store(bytes, std::memory_order_relaxed);
+}
+
+Allocator::Buffer Allocator::allocate(size_t size) {
+    size_t bytes = size * sizeof(float);
+
+#ifdef __linux__
+    auto &current = settings();
+    if (bytes >= current.threshold.load(std::memory_order_relaxed) && bytes > 0) {
+        // Whole huge pages; anonymous mappings are already zeroed
+        size_t mappedBytes = (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+        auto hugePages = current.hugePages.load(std::memory_order_relaxed);
+        void *data = MAP_FAILED;
+        if (hugePages == HugePages::Explicit) {
+            data = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+        if (data == MAP_FAILED) {
+            // Also the fallback when no explicit huge pages are reserved
+            data = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (data != MAP_FAILED && hugePages != HugePages::Off) {
+                madvise(data, mappedBytes, MADV_HUGEPAGE);
+            }
+        }
+        if (data == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        // Placement is advisory; a failure (e.g. a single-node host) leaves first-touch behaviour
+        auto placement = current.placement.load(std::memory_order_acquire);
+        if (placement != Placement::Local) {
+            int node = current.node.load(std::memory_order_relaxed);
+            unsigned long mask[kMaxNodes / 64] = {};
+            int mode = MPOL_INTERLEAVE;
+            if (placement == Placement::Interleave) {
+                std::memset(mask, 0xff, sizeof(mask));
+            } else {
+                mode = MPOL_PREFERRED;
+                mask[node / 64] = 1ul << (node % 64);
+            }
+            syscall(SYS_mbind, data, mappedBytes, mode, mask, sizeof(mask) * 8, 0);
+        }
+
+        sLiveBytes.fetch_add(mappedBytes, std::memory_order_relaxed);
+        return Buffer(static_cast<float *>(data), Deleter{mappedBytes, true});
+    }
+#endif
+
+    Buffer buffer(new float[size](), Deleter{bytes, false});
+    sLiveBytes.fetch_add(bytes, std::memory_order_relaxed);
+    return buffer;
+}
+
+void Allocator::Deleter::operator()(float *data) const {
+    sLiveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+#ifdef __linux__
+    if (mapped) {
+        munmap(data, bytes);
+        return;
+    }
+#endif
+    delete[] data;
+}
@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "BatchScorer.h"
+#include "MappedFile.h"
+#include "ThreadAffinity.h"
+
+namespace {
+    // Consumed input is released from memory in steps of this many bytes
+    constexpr size_t kReleaseBytes = 64 * 1024 * 1024;
+
+    bool isBlank(const char *begin, const char *end) {
+        return std::all_of(begin, end, [](char c) { return c == ' ' || c == '\t' || c == '\r'; });
+    }
+
+    // Parses one CSV line of exactly `count` numbers into `out`
+    bool parseLine(const char *begin, const char *end, size_t count, float *out) {
+        const char *p = begin;
+        for (size_t k = 0; k < count; ++k) {
+            while (p < end && (*p == ' ' || *p == '\t')) {
+                ++p;
+            }
+            // from_chars rejects a leading '+'
+            if (p < end && *p == '+') {
+                ++p;
+            }
+            auto parsed = std::from_chars(p, end, out[k]);
+            if (parsed.ec != std::errc()) {
+                return false;
+            }
+            p = parsed.ptr;
+            while (p < end && (*p == ' ' || *p == '\t')) {
+                ++p;
+            }
+            if (k + 1 < count) {
+                if (p == end || *p != ',') {
+                    return false;
+                }
+                ++p;
+            }
+        }
+        return isBlank(p, end);
+    }
+}
+
+BatchScorer::BatchScorer(MultiLayerPerceptron &model) {
+    for (auto &layer: model.getLayers()) {
+        DenseLayer dense{layer->getNIn(), layer->getNOut(), layer->getActivation(), {}, {}};
+        // Parameters come in (weight, bias) pairs per neuron
+        auto parameters = layer->getParameters();
+        for (size_t p = 0; p < parameters->size(); p += 2) {
+            auto weight = (*parameters)[p]->getDataSpan();
+            dense.weights.insert(dense.weights.end(), weight.begin(), weight.end());
+            dense.bias.push_back((*parameters)[p + 1]->at(0));
+        }
+        mLayers.push_back(std::move(dense));
+    }
+    if (mLayers.empty()) {
+        throw std::logic_error("empty network");
+    }
+}
+
+size_t BatchScorer::getNIn() const {
+    return mLayers.front().nIn;
+}
+
+size_t BatchScorer::getNOut() const {
+    return mLayers.back().nOut;
+}
+
+void BatchScorer::predict(const float *input, size_t rows, float *output, std::vector<float> &scratch) const {
+    // Hidden activations alternate between two halves of the scratch buffer
+    size_t widest = 0;
+    for (auto &layer: mLayers) {
+        widest = std::max(widest, layer.nOut);
+    }
+    scratch.resize(2 * rows * widest);
+
+    const float *in = input;
+    for (size_t l = 0; l < mLayers.size(); ++l) {
+        auto &layer = mLayers[l];
+        float *out = l + 1 == mLayers.size() ? output : scratch.data() + (l % 2) * rows * widest;
+        for (size_t r = 0; r < rows; ++r) {
+            const float *x = in + r * layer.nIn;
+            for (size_t j = 0; j < layer.nOut; ++j) {
+                const float *w = layer.weights.data() + j * layer.nIn;
+                // Independent partial sums so the loop vectorises
+                float partial[8] = {};
+                size_t k = 0;
+                for (; k + 8 <= layer.nIn; k += 8) {
+                    for (size_t lane = 0; lane < 8; ++lane) {
+                        partial[lane] += w[k + lane] * x[k + lane];
+                    }
+                }
+                float sum = layer.bias[j];
+                for (; k < layer.nIn; ++k) {
+                    sum += w[k] * x[k];
+                }
+                for (float value: partial) {
+                    sum += value;
+                }
+                out[r * layer.nOut + j] = activate(layer.activation, sum);
+            }
+        }
+        in = out;
+    }
+}
+
+BatchScorer::Format BatchScorer::formatOf(const std::string &path) {
+    auto dot = path.rfind('.');
+    return dot != std::string::npos && path.substr(dot) == ".csv" ? Format::Csv : Format::Binary;
+}
+
+BatchScorer::Report BatchScorer::score(const std::string &inputPath, Format inputFormat, std::ostream &output,
+                                       const Options &options) const {
+    MappedFile file(inputPath);
+    const char *begin = file.getData();
+    const char *end = begin + file.getSize();
+    size_t nIn = getNIn();
+    size_t nOut = getNOut();
+    size_t rowBytes = nIn * sizeof(float);
+
+    size_t threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    size_t batchRows = std::max<size_t>(1, options.batchRows);
+    size_t inFlight = options.inFlight ? options.inFlight : 2 * threads;
+
+    // Lines before the first minibatch, i.e. a CSV header
+    size_t skippedLines = 0;
+    if (inputFormat == Format::Binary) {
+        if (file.getSize() % rowBytes != 0) {
+            throw std::runtime_error("binary input is not a whole number of rows of " + std::to_string(nIn) + " floats");
+        }
+    } else if (begin != end) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+        lineEnd = lineEnd ? lineEnd : end;
+        std::vector<float> row(nIn);
+        if (!parseLine(begin, lineEnd, nIn, row.data())) {
+            begin = lineEnd == end ? end : lineEnd + 1;
+            skippedLines = 1;
+        }
+    }
+
+    // A minibatch moves from dispatch, to scored and formatted, to written; each one
+    // occupies slot `index % inFlight` until the writer has consumed it
+    struct Slot {
+        size_t batch = 0;
+        bool ready = false;
+        size_t rows = 0;
+        size_t inputEnd = 0;
+        std::string bytes;
+    };
+    std::vector<Slot> slots(inFlight);
+    std::mutex mutex;
+    std::condition_variable changed;
+    const char *position = begin;
+    size_t dispatched = 0;
+    size_t written = 0;
+    size_t active = 0;
+    std::exception_ptr error;
+    std::vector<double> latencies;
+
+    auto worker = [&]() {
+        std::vector<float> input;
+        std::vector<float> predictions;
+        std::vector<float> scratch;
+        char number[32];
+
+        while (true) {
+            const char *batchBegin;
+            const char *batchEnd;
+            size_t batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (position == end || error) {
+                    return;
+                }
+                // Take the next range: a whole number of binary rows, or of CSV lines
+                batchBegin = position;
+                if (inputFormat == Format::Binary) {
+                    batchEnd = batchBegin + std::min<size_t>(batchRows * rowBytes, end - batchBegin);
+                } else {
+                    batchEnd = batchBegin;
+                    for (size_t line = 0; line < batchRows && batchEnd < end; ++line) {
+                        auto newline = static_cast<const char *>(std::memchr(batchEnd, '\n', end - batchEnd));
+                        batchEnd = newline ? newline + 1 : end;
+                    }
+                }
+                position = batchEnd;
+                batch = dispatched++;
+                ++active;
+
+                // Bound memory: wait until the writer has freed this minibatch's slot
+                changed.wait(lock, [&]() { return batch < written + inFlight || error; });
+                if (error) {
+                    --active;
+                    changed.notify_all();
+                    return;
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            auto &slot = slots[batch % inFlight];
+            try {
+                const float *rows;
+                size_t count;
+                if (inputFormat == Format::Binary) {
+                    rows = reinterpret_cast<const float *>(batchBegin);
+                    count = static_cast<size_t>(batchEnd - batchBegin) / rowBytes;
+                } else {
+                    input.resize(batchRows * nIn);
+                    count = 0;
+                    size_t line = 0;
+                    for (const char *p = batchBegin; p < batchEnd; ++line) {
+                        auto newline = static_cast<const char *>(std::memchr(p, '\n', batchEnd - p));
+                        const char *lineEnd = newline ? newline : batchEnd;
+                        if (!isBlank(p, lineEnd)) {
+                            if (!parseLine(p, lineEnd, nIn, input.data() + count * nIn)) {
+                                throw std::runtime_error("malformed CSV at line " +
+                                                         std::to_string(skippedLines + batch * batchRows + line + 1));
+                            }
+                            ++count;
+                        }
+                        p = lineEnd + 1;
+                    }
+                    rows = input.data();
+                }
+
+                predictions.resize(count * nOut);
+                predict(rows, count, predictions.data(), scratch);
+
+                slot.bytes.clear();
+                if (options.outputFormat == Format::Binary) {
+                    slot.bytes.append(reinterpret_cast<const char *>(predictions.data()), predictions.size() * sizeof(float));
+                } else {
+                    for (size_t r = 0; r < count; ++r) {
+                        for (size_t j = 0; j < nOut; ++j) {
+                            auto formatted = std::to_chars(number, number + sizeof(number), predictions[r * nOut + j]);
+                            slot.bytes.append(number, formatted.ptr);
+                            slot.bytes.push_back(j + 1 < nOut ? ',' : '\n');
+                        }
+                    }
+                }
+                slot.rows = count;
+                slot.inputEnd = static_cast<size_t>(batchEnd - file.getData());
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                --active;
+                changed.notify_all();
+                return;
+            }
+
+            std::chrono::duration<double> latency = std::chrono::steady_clock::now() - start;
+            std::lock_guard<std::mutex> lock(mutex);
+            latencies.push_back(latency.count());
+            slot.batch = batch;
+            slot.ready = true;
+            --active;
+            changed.notify_all();
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back(worker);
+        ThreadAffinity::pin(workers.back(), t);
+    }
+
+    // Write minibatches in input order as they complete
+    Report report;
+    size_t released = 0;
+    while (true) {
+        Slot *slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() {
+                auto &next = slots[written % inFlight];
+                return error || (next.ready && next.batch == written) ||
+                       (position == end && active == 0 && written == dispatched);
+            });
+            if (error) {
+                break;
+            }
+            slot = &slots[written % inFlight];
+            if (!slot->ready) {
+                break;
+            }
+        }
+
+        // The slot is not reused until `written` moves past it
+        output.write(slot->bytes.data(), static_cast<std::streamsize>(slot->bytes.size()));
+        report.rows += slot->rows;
+        if (slot->inputEnd >= released + kReleaseBytes) {
+            file.release(slot->inputEnd);
+            released = slot->inputEnd;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        slot->ready = false;
+        ++written;
+        changed.notify_all();
+    }
+
+    for (auto &thread: workers) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    output.flush();
+    if (!output) {
+        throw std::runtime_error("failed to write predictions");
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    report.batches = written;
+    report.seconds = elapsed.count();
+    report.rowsPerSecond = report.seconds > 0.0 ? static_cast<double>(report.rows) / report.seconds : 0.0;
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double p) {
+            return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * static_cast<double>(latencies.size())))];
+        };
+        report.p50 = percentile(0.5);
+        report.p90 = percentile(0.9);
+        report.p99 = percentile(0.99);
+        report.max = latencies.back();
+    }
+    return report;
+}
@@ -0,0 +1,64 @@
+#include "BlockSparseLayer.h"
+
+BlockSparseLayer::BlockSparseLayer(Layer &layer)
+        : mNIn(layer.getNIn()), mNOut(layer.getNOut()), mActivation(layer.getActivation()) {
+    // Parameters come in (weight, bias) pairs per neuron
+    auto parameters = layer.getParameters();
+    mRowStart.push_back(0);
+    for (size_t o = 0; o < mNOut; o++) {
+        auto weight = (*parameters)[2 * o]->getDataSpan();
+        for (size_t column = 0; column < mNIn; column += kBlockSize) {
+            float block[kBlockSize] = {};
+            bool nonzero = false;
+            for (size_t i = 0; i < kBlockSize && column + i < mNIn; i++) {
+                block[i] = weight[column + i];
+                nonzero = nonzero || block[i] != 0.0f;
+            }
+            if (nonzero) {
+                mBlockColumn.push_back(static_cast<uint32_t>(column));
+                mBlockWeights.insert(mBlockWeights.end(), block, block + kBlockSize);
+            }
+        }
+        mRowStart.push_back(mBlockColumn.size());
+        mBias.push_back((*parameters)[2 * o + 1]->at(0));
+    }
+}
+
+size_t BlockSparseLayer::getNIn() const {
+    return mNIn;
+}
+
+size_t BlockSparseLayer::getNOut() const {
+    return mNOut;
+}
+
+float BlockSparseLayer::getDensity() const {
+    size_t blocksPerRow = (mNIn + kBlockSize - 1) / kBlockSize;
+    return static_cast<float>(mBlockColumn.size()) / static_cast<float>(blocksPerRow * mNOut);
+}
+
+void BlockSparseLayer::operator()(const float *input, float *output) const {
+    for (size_t o = 0; o < mNOut; o++) {
+        float lanes[kBlockSize] = {};
+        for (size_t b = mRowStart[o]; b < mRowStart[o + 1]; b++) {
+            const float *weights = &mBlockWeights[b * kBlockSize];
+            const float *x = input + mBlockColumn[b];
+            if (mBlockColumn[b] + kBlockSize <= mNIn) {
+                for (size_t i = 0; i < kBlockSize; i++) {
+                    lanes[i] += weights[i] * x[i];
+                }
+            } else {
+                // Last block of a row whose width is not a multiple of the block size
+                for (size_t i = 0; mBlockColumn[b] + i < mNIn; i++) {
+                    lanes[i] += weights[i] * x[i];
+                }
+            }
+        }
+
+        float sum = 0.0f;
+        for (float lane: lanes) {
+            sum += lane;
+        }
+        output[o] = activate(mActivation, sum + mBias[o]);
+    }
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <stdexcept>
+#include "Curvature.h"
+
+namespace {
+    // Sufficient decrease constant of the line search
+    constexpr float kArmijo = 1e-4f;
+}
+
+size_t Curvature::getSize(const Parameters &parameters) {
+    size_t size = 0;
+    for (auto &parameter: parameters) {
+        size += parameter->getSize();
+    }
+    return size;
+}
+
+std::vector<float> Curvature::getData(const Parameters &parameters) {
+    std::vector<float> data;
+    data.reserve(getSize(parameters));
+    for (auto &parameter: parameters) {
+        auto span = parameter->getDataSpan();
+        data.insert(data.end(), span.begin(), span.end());
+    }
+    return data;
+}
+
+void Curvature::setData(const Parameters &parameters, const std::vector<float> &data) {
+    if (data.size() != getSize(parameters)) {
+        throw std::logic_error("size mismatch");
+    }
+    auto it = data.begin();
+    for (auto &parameter: parameters) {
+        auto span = parameter->getDataSpan();
+        std::copy(it, it + span.size(), span.begin());
+        parameter->markModified();
+        it += span.size();
+    }
+}
+
+float Curvature::gradient(const Parameters &parameters, const Objective &objective, std::vector<float> &gradient) {
+    for (auto &parameter: parameters) {
+        parameter->clearGrad();
+    }
+    auto loss = objective();
+    loss->backward();
+
+    gradient.clear();
+    gradient.reserve(getSize(parameters));
+    for (auto &parameter: parameters) {
+        if (parameter->hasGrad()) {
+            auto grad = parameter->getGradSpan();
+            gradient.insert(gradient.end(), grad.begin(), grad.end());
+        } else {
+            gradient.insert(gradient.end(), parameter->getSize(), 0.0f);
+        }
+    }
+    return loss->at(0);
+}
+
+float Curvature::loss(const Objective &objective) {
+    Value::NoGrad noGrad;
+    return objective()->at(0);
+}
+
+bool Curvature::lineSearch(const Parameters &parameters, const std::vector<float> &direction, float loss,
+                           float slope, const std::function<float()> &evaluate, float &step) {
+    auto start = getData(parameters);
+    std::vector<float> trial(start.size());
+    float t = step;
+    for (size_t halving = 0; halving <= kMaxHalvings; ++halving, t *= 0.5f) {
+        for (size_t i = 0; i < trial.size(); ++i) {
+            trial[i] = start[i] + t * direction[i];
+        }
+        setData(parameters, trial);
+        if (evaluate() <= loss + kArmijo * t * slope) {
+            step = t;
+            return true;
+        }
+    }
+    setData(parameters, start);
+    return false;
+}
+
+float Curvature::dot(const std::vector<float> &a, const std::vector<float> &b) {
+    double sum = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        sum += static_cast<double>(a[i]) * b[i];
+    }
+    return static_cast<float>(sum);
+}
+
+std::vector<float> Curvature::hessianVectorProduct(const Parameters &parameters, const Objective &objective,
+                                                   const std::vector<float> &v) {
+    if (v.size() != getSize(parameters)) {
+        throw std::logic_error("size mismatch");
+    }
+
+    auto it = v.begin();
+    for (auto &parameter: parameters) {
+        parameter->clearGrad();
+        auto tangent = parameter->getTangentSpan();
+        std::copy(it, it + tangent.size(), tangent.begin());
+        it += tangent.size();
+    }
+
+    objective()->backward();
+
+    std::vector<float> result;
+    result.reserve(v.size());
+    for (auto &parameter: parameters) {
+        if (parameter->hasGradTangent()) {
+            auto gradTangent = parameter->getGradTangentSpan();
+            result.insert(result.end(), gradTangent.begin(), gradTangent.end());
+        } else {
+            result.insert(result.end(), parameter->getSize(), 0.0f);
+        }
+        parameter->clearTangent();
+    }
+    return result;
+}
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include "DataParallel.h"
+
+DataParallel::DataParallel(MultiLayerPerceptron &model, Transport &transport, size_t bucketSize)
+        : mTransport(transport), mParameters(model.getParameters()) {
+    // Gradients become final from the output backwards, so fill buckets in reverse
+    for (auto it = mParameters->rbegin(); it != mParameters->rend(); ++it) {
+        if (mBuckets.empty() || mBuckets.back().buffer.size() >= bucketSize) {
+            mBuckets.emplace_back();
+        }
+        auto &bucket = mBuckets.back();
+        bucket.parameters.push_back(*it);
+        bucket.buffer.resize(bucket.buffer.size() + (*it)->getSize());
+        mBucketOf[it->get()] = mBuckets.size() - 1;
+    }
+}
+
+void DataParallel::synchronizeParameters() {
+    for (auto &bucket: mBuckets) {
+        size_t offset = 0;
+        for (auto &parameter: bucket.parameters) {
+            auto data = parameter->getDataSpan();
+            std::copy(data.begin(), data.end(), bucket.buffer.begin() + offset);
+            offset += data.size();
+        }
+
+        mTransport.allReduce({bucket.buffer.data(), bucket.buffer.size()});
+
+        offset = 0;
+        for (auto &parameter: bucket.parameters) {
+            auto data = parameter->getDataSpan();
+            std::copy(bucket.buffer.begin() + offset, bucket.buffer.begin() + offset + data.size(), data.begin());
+            parameter->markModified();
+            offset += data.size();
+        }
+    }
+}
+
+void DataParallel::reduce(Bucket &bucket) {
+    size_t offset = 0;
+    for (auto &parameter: bucket.parameters) {
+        auto grad = parameter->getGradSpan();
+        std::copy(grad.begin(), grad.end(), bucket.buffer.begin() + offset);
+        offset += grad.size();
+    }
+
+    mTransport.allReduce({bucket.buffer.data(), bucket.buffer.size()});
+
+    offset = 0;
+    for (auto &parameter: bucket.parameters) {
+        auto grad = parameter->getGradSpan();
+        std::copy(bucket.buffer.begin() + offset, bucket.buffer.begin() + offset + grad.size(), grad.begin());
+        offset += grad.size();
+    }
+}
+
+void DataParallel::backward(Value &loss) {
+    for (auto &bucket: mBuckets) {
+        bucket.pending = bucket.parameters.size();
+        bucket.ready = false;
+    }
+    mStopping = false;
+
+    // Buckets are reduced strictly in order so that every rank pairs up the same collectives
+    std::exception_ptr error;
+    std::thread thread([this, &error]() {
+        try {
+            for (auto &bucket: mBuckets) {
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mReady.wait(lock, [this, &bucket]() { return bucket.ready || mStopping; });
+                    if (!bucket.ready) {
+                        return;
+                    }
+                }
+                reduce(bucket);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+    });
+
+    // Stops and joins the communicator if the backward pass throws, rather than terminating
+    struct Communicator {
+        DataParallel &owner;
+        std::thread &thread;
+
+        ~Communicator() {
+            if (!thread.joinable()) {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(owner.mMutex);
+                owner.mStopping = true;
+            }
+            owner.mReady.notify_one();
+            thread.join();
+        }
+    } communicator{*this, thread};
+
+    loss.backward([this](Value *leaf) {
+        auto it = mBucketOf.find(leaf);
+        if (it == mBucketOf.end()) {
+            return;
+        }
+        auto &bucket = mBuckets[it->second];
+        if (--bucket.pending == 0) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            bucket.ready = true;
+            mReady.notify_one();
+        }
+    });
+
+    // Parameters the loss did not reach still take part, with zero gradients
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto &bucket: mBuckets) {
+            bucket.ready = true;
+        }
+        mReady.notify_one();
+    }
+    thread.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <stdexcept>
+#include "Ensemble.h"
+
+Ensemble::Ensemble(size_t members, size_t nIn, std::vector<size_t> nOuts)
+        : Ensemble(members, nIn, nOuts, std::vector<Activation>(nOuts.size(), Activation::Tanh)) {
+}
+
+Ensemble::Ensemble(size_t members, size_t nIn, std::vector<size_t> nOuts, std::vector<Activation> activations)
+        : mMembers(members) {
+    if (activations.size() != nOuts.size()) {
+        throw std::logic_error("size mismatch");
+    }
+    if (members == 0 || nOuts.empty()) {
+        throw std::logic_error("empty ensemble");
+    }
+
+    auto currIn = nIn;
+    for (size_t i = 0; i < nOuts.size(); i++) {
+        StackedLayer layer{currIn, nOuts[i], activations[i],
+                           std::make_shared<Value>(Value::rand(members * nOuts[i] * currIn, -1.0f, 1.0f)),
+                           std::make_shared<Value>(Value::rand(members * nOuts[i], -1.0f, 1.0f))};
+        mLayers.push_back(std::move(layer));
+        currIn = nOuts[i];
+    }
+}
+
+Ensemble::Ensemble(std::vector<MultiLayerPerceptron> &models) : mMembers(models.size()) {
+    if (models.empty() || models.front().getLayers().empty()) {
+        throw std::logic_error("empty ensemble");
+    }
+
+    auto &architecture = models.front().getLayers();
+    for (auto &layer: architecture) {
+        size_t nIn = layer->getNIn();
+        size_t nOut = layer->getNOut();
+        mLayers.push_back({nIn, nOut, layer->getActivation(), std::make_shared<Value>(mMembers * nOut * nIn),
+                           std::make_shared<Value>(mMembers * nOut)});
+    }
+
+    for (size_t m = 0; m < mMembers; m++) {
+        auto &layers = models[m].getLayers();
+        if (layers.size() != mLayers.size()) {
+            throw std::logic_error("architecture mismatch");
+        }
+        for (size_t l = 0; l < mLayers.size(); l++) {
+            auto &stacked = mLayers[l];
+            if (layers[l]->getNIn() != stacked.nIn || layers[l]->getNOut() != stacked.nOut ||
+                layers[l]->getActivation() != stacked.activation) {
+                throw std::logic_error("architecture mismatch");
+            }
+
+            // Parameters come in (weight, bias) pairs per neuron
+            auto parameters = layers[l]->getParameters();
+            auto weights = stacked.weights->getDataSpan();
+            auto bias = stacked.bias->getDataSpan();
+            for (size_t o = 0; o < stacked.nOut; o++) {
+                auto weight = (*parameters)[2 * o]->getDataSpan();
+                std::copy(weight.begin(), weight.end(), weights.begin() + (m * stacked.nOut + o) * stacked.nIn);
+                bias[m * stacked.nOut + o] = (*parameters)[2 * o + 1]->at(0);
+            }
+        }
+    }
+}
+
+size_t Ensemble::getMembers() const {
+    return mMembers;
+}
+
+size_t Ensemble::getNIn() const {
+    return mLayers.front().nIn;
+}
+
+size_t Ensemble::getNOut() const {
+    return mLayers.back().nOut;
+}
+
+std::shared_ptr<std::vector<std::shared_ptr<Value>>> Ensemble::getParameters() {
+    auto result = std::make_shared<std::vector<std::shared_ptr<Value>>>();
+    for (auto &layer: mLayers) {
+        result->push_back(layer.weights);
+        result->push_back(layer.bias);
+    }
+    return result;
+}
+
+MultiLayerPerceptron Ensemble::getMember(size_t member) {
+    if (member >= mMembers) {
+        throw std::out_of_range("member out of range");
+    }
+
+    std::vector<size_t> nOuts;
+    std::vector<Activation> activations;
+    for (auto &layer: mLayers) {
+        nOuts.push_back(layer.nOut);
+        activations.push_back(layer.activation);
+    }
+
+    MultiLayerPerceptron model(getNIn(), nOuts, activations);
+    for (size_t l = 0; l < mLayers.size(); l++) {
+        auto &stacked = mLayers[l];
+        auto parameters = model.getLayers()[l]->getParameters();
+        auto weights = stacked.weights->getDataSpan();
+        auto bias = stacked.bias->getDataSpan();
+        for (size_t o = 0; o < stacked.nOut; o++) {
+            auto row = weights.begin() + (member * stacked.nOut + o) * stacked.nIn;
+            std::copy(row, row + stacked.nIn, (*parameters)[2 * o]->getDataSpan().begin());
+            (*(*parameters)[2 * o + 1])[0] = bias[member * stacked.nOut + o];
+            (*parameters)[2 * o]->markModified();
+            (*parameters)[2 * o + 1]->markModified();
+        }
+    }
+    return model;
+}
+
+Value *Ensemble::operator()(Value &input, Value *output) {
+    auto currInput = &input;
+    for (size_t l = 0; l < mLayers.size(); l++) {
+        auto &layer = mLayers[l];
+        auto d = currInput->stackedAffine(*layer.weights, *layer.bias, mMembers);
+        currInput = activate(d, layer.activation, l + 1 == mLayers.size() ? output : nullptr);
+    }
+    return currInput;
+}
+
+void Ensemble::step(float learningRate) {
+    step(std::vector<float>(mMembers, learningRate));
+}
+
+void Ensemble::step(const std::vector<float> &learningRates) {
+    if (learningRates.size() != mMembers) {
+        throw std::logic_error("size mismatch");
+    }
+
+    auto parameters = getParameters();
+    for (auto &parameter: *parameters) {
+        // Each member owns one equal, contiguous slice of every stacked parameter
+        size_t slice = parameter->getSize() / mMembers;
+        auto grad = parameter->getGradSpan();
+        auto data = parameter->getDataSpan();
+        for (size_t m = 0; m < mMembers; m++) {
+            for (size_t i = m * slice; i < (m + 1) * slice; i++) {
+                data[i] -= learningRates[m] * grad[i];
+            }
+        }
+        parameter->markModified();
+    }
+}
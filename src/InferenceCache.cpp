@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "InferenceCache.h"
+
+namespace {
+    // List and hash table nodes of an entry, roughly
+    constexpr size_t kNodeBytes = 64;
+
+    uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    // Eight bytes per round; equal bit patterns hash equally, so -0 and 0 differ
+    uint64_t hashOf(Span<const float> data) {
+        auto bytes = reinterpret_cast<const unsigned char *>(data.begin());
+        size_t size = data.size() * sizeof(float);
+        uint64_t hash = 0x9e3779b97f4a7c15ULL ^ size;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, 8);
+            hash = (hash ^ mix(word)) * 0x100000001b3ULL;
+        }
+        if (i < size) {
+            uint64_t word = 0;
+            std::memcpy(&word, bytes + i, size - i);
+            hash = (hash ^ mix(word)) * 0x100000001b3ULL;
+        }
+        return mix(hash);
+    }
+
+    bool sameData(const std::vector<float> &stored, Span<const float> data) {
+        return stored.size() == data.size() &&
+               std::memcmp(stored.data(), data.begin(), data.size() * sizeof(float)) == 0;
+    }
+}
+
+InferenceCache::InferenceCache(MultiLayerPerceptron &model) : InferenceCache(model, Options()) {
+}
+
+InferenceCache::InferenceCache(MultiLayerPerceptron &model, const Options &options)
+        : mModel(model), mParameters(model.getParameters()) {
+    size_t shards = std::max<size_t>(1, options.shards);
+    for (size_t s = 0; s < shards; ++s) {
+        mShards.push_back(std::make_unique<Shard>());
+    }
+    mShardBytes = options.maxBytes / shards;
+}
+
+Value *InferenceCache::operator()(Value &input, Value *output) {
+    auto data = input.getDataSpan();
+    size_t version = getParameterVersion();
+    uint64_t hash = hashOf(data);
+    auto &shard = shardOf(hash);
+
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        invalidate(shard, version);
+        auto found = shard.index.find(hash);
+        if (found != shard.index.end() && sameData(found->second->input, data)) {
+            shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+            auto &cached = found->second->output;
+            auto result = output ? output : new Value(cached.size());
+            if (result->getSize() != cached.size()) {
+                throw std::logic_error("size mismatch");
+            }
+            std::copy(cached.begin(), cached.end(), result->getDataSpan().begin());
+            result->markModified();
+            result->setRequiresGrad(false);
+            mHits.fetch_add(1, std::memory_order_relaxed);
+            return result;
+        }
+    }
+    mMisses.fetch_add(1, std::memory_order_relaxed);
+
+    Value *result;
+    Entry entry{hash, {data.begin(), data.end()}, {}};
+    {
+        Value::NoGrad noGrad;
+        result = mModel(input, output);
+    }
+    auto computed = result->getDataSpan();
+    entry.output.assign(computed.begin(), computed.end());
+
+    size_t bytes = sizeOf(entry);
+    if (bytes > mShardBytes) {
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    invalidate(shard, version);
+    // Computed with parameters that have since been overwritten
+    if (shard.version != version) {
+        return result;
+    }
+    auto found = shard.index.find(hash);
+    if (found != shard.index.end()) {
+        // Another thread got here first, or a different input with the same hash
+        shard.bytes -= sizeOf(*found->second);
+        mBytes.fetch_sub(sizeOf(*found->second), std::memory_order_relaxed);
+        mEntries.fetch_sub(1, std::memory_order_relaxed);
+        shard.entries.erase(found->second);
+        shard.index.erase(found);
+    }
+    shard.entries.push_front(std::move(entry));
+    shard.index.emplace(hash, shard.entries.begin());
+    shard.bytes += bytes;
+    mBytes.fetch_add(bytes, std::memory_order_relaxed);
+    mEntries.fetch_add(1, std::memory_order_relaxed);
+
+    while (shard.bytes > mShardBytes) {
+        auto &last = shard.entries.back();
+        size_t lastBytes = sizeOf(last);
+        shard.index.erase(last.hash);
+        shard.entries.pop_back();
+        shard.bytes -= lastBytes;
+        mBytes.fetch_sub(lastBytes, std::memory_order_relaxed);
+        mEntries.fetch_sub(1, std::memory_order_relaxed);
+        mEvictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    return result;
+}
+
+size_t InferenceCache::getHits() const {
+    return mHits.load(std::memory_order_relaxed);
+}
+
+size_t InferenceCache::getMisses() const {
+    return mMisses.load(std::memory_order_relaxed);
+}
+
+size_t InferenceCache::getEvictions() const {
+    return mEvictions.load(std::memory_order_relaxed);
+}
+
+size_t InferenceCache::getInvalidations() const {
+    return mInvalidations.load(std::memory_order_relaxed);
+}
+
+size_t InferenceCache::getBytes() const {
+    return mBytes.load(std::memory_order_relaxed);
+}
+
+size_t InferenceCache::getEntries() const {
+    return mEntries.load(std::memory_order_relaxed);
+}
+
+void InferenceCache::clear() {
+    for (auto &shard: mShards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        mBytes.fetch_sub(shard->bytes, std::memory_order_relaxed);
+        mEntries.fetch_sub(shard->entries.size(), std::memory_order_relaxed);
+        shard->entries.clear();
+        shard->index.clear();
+        shard->bytes = 0;
+    }
+}
+
+size_t InferenceCache::getParameterVersion() const {
+    // Each parameter's count only grows, so the sum changes whenever any of them is written
+    size_t version = 0;
+    for (auto &parameter: *mParameters) {
+        version += parameter->getVersion();
+    }
+    return version;
+}
+
+InferenceCache::Shard &InferenceCache::shardOf(uint64_t hash) {
+    // The low bits already pick the hash table bucket within the shard
+    return *mShards[(hash >> 32) % mShards.size()];
+}
+
+void InferenceCache::invalidate(Shard &shard, size_t version) {
+    // Versions only grow, so an older reader must not discard newer entries
+    if (version <= shard.version) {
+        return;
+    }
+    mInvalidations.fetch_add(shard.entries.size(), std::memory_order_relaxed);
+    mBytes.fetch_sub(shard.bytes, std::memory_order_relaxed);
+    mEntries.fetch_sub(shard.entries.size(), std::memory_order_relaxed);
+    shard.entries.clear();
+    shard.index.clear();
+    shard.bytes = 0;
+    shard.version = version;
+}
+
+size_t InferenceCache::sizeOf(const Entry &entry) {
+    return sizeof(Entry) + kNodeBytes + (entry.input.size() + entry.output.size()) * sizeof(float);
+}
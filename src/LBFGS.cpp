@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cmath>
+#include "LBFGS.h"
+
+LBFGS::LBFGS(std::shared_ptr<Curvature::Parameters> parameters, size_t history)
+        : mParameters(std::move(parameters)), mHistory(history) {
+}
+
+float LBFGS::step(const Curvature::Objective &objective) {
+    auto &parameters = *mParameters;
+    if (mGradient.empty()) {
+        mLoss = Curvature::gradient(parameters, objective, mGradient);
+    }
+    size_t n = mGradient.size();
+
+    // Two-loop recursion: direction = -H g, with H0 scaled by the latest curvature pair
+    std::vector<float> direction(mGradient);
+    std::vector<float> alpha(mS.size());
+    for (size_t k = mS.size(); k-- > 0;) {
+        alpha[k] = Curvature::dot(mS[k], direction) / Curvature::dot(mY[k], mS[k]);
+        for (size_t i = 0; i < n; ++i) {
+            direction[i] -= alpha[k] * mY[k][i];
+        }
+    }
+    float scale = 1.0f;
+    if (!mS.empty()) {
+        scale = Curvature::dot(mS.back(), mY.back()) / Curvature::dot(mY.back(), mY.back());
+    } else {
+        // First step: keep the initial trial step at most unit length
+        scale = std::min(1.0f, 1.0f / std::sqrt(Curvature::dot(mGradient, mGradient) + 1e-12f));
+    }
+    for (size_t i = 0; i < n; ++i) {
+        direction[i] *= scale;
+    }
+    for (size_t k = 0; k < mS.size(); ++k) {
+        float beta = Curvature::dot(mY[k], direction) / Curvature::dot(mY[k], mS[k]);
+        for (size_t i = 0; i < n; ++i) {
+            direction[i] += (alpha[k] - beta) * mS[k][i];
+        }
+    }
+    for (auto &d: direction) {
+        d = -d;
+    }
+
+    // Not a descent direction: forget the history and follow the gradient
+    float slope = Curvature::dot(mGradient, direction);
+    if (slope >= 0.0f) {
+        mS.clear();
+        mY.clear();
+        for (size_t i = 0; i < n; ++i) {
+            direction[i] = -mGradient[i];
+        }
+        slope = Curvature::dot(mGradient, direction);
+    }
+
+    // Backtracking line search; the gradient at the accepted point is kept for the next step
+    std::vector<float> gradient;
+    float loss = mLoss;
+    float t = mStep;
+    bool accepted = Curvature::lineSearch(parameters, direction, mLoss, slope, [&]() {
+        loss = Curvature::gradient(parameters, objective, gradient);
+        return loss;
+    }, t);
+
+    // No acceptable step: stay put and restart from steepest descent. When that was already
+    // the direction, go on from steps smaller than any tried so the search is not repeated.
+    if (!accepted) {
+        if (mS.empty()) {
+            mStep = std::ldexp(mStep, -static_cast<int>(Curvature::kMaxHalvings) - 1);
+        }
+        mS.clear();
+        mY.clear();
+        return mLoss;
+    }
+    mStep = 1.0f;
+
+    // Curvature pair, skipped unless it keeps the approximation positive definite
+    std::vector<float> s(n), y(n);
+    for (size_t i = 0; i < n; ++i) {
+        s[i] = t * direction[i];
+        y[i] = gradient[i] - mGradient[i];
+    }
+    if (Curvature::dot(s, y) > 1e-10f) {
+        mS.push_back(std::move(s));
+        mY.push_back(std::move(y));
+        if (mS.size() > mHistory) {
+            mS.pop_front();
+            mY.pop_front();
+        }
+    }
+
+    float previous = mLoss;
+    mGradient = std::move(gradient);
+    mLoss = loss;
+    return previous;
+}
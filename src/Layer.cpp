@@ -2,17 +2,34 @@
 // Created by tom on 20/07/23.
 //
 #include "Layer.h"
+#include "SparseValue.h"
 
-Layer::Layer(size_t nIn, size_t nOut) : mNIn(nIn), mNOut(nOut) {
+Layer::Layer(size_t nIn, size_t nOut, Activation activation) : mNIn(nIn), mNOut(nOut), mActivation(activation) {
     for (size_t i = 0; i < nOut; i++) {
-        mNeurons.push_back(std::make_shared<Neuron>(nIn));
+        mNeurons.push_back(std::make_shared<Neuron>(nIn, activation));
     }
 }
 
-Value *Layer::operator()(Value &input) {
+Value *Layer::operator()(Value &input, Value *output) {
+    return forward(input, output);
+}
+
+Value *Layer::operator()(SparseValue &input, Value *output) {
+    return forward(input, output);
+}
+
+template <typename Input>
+Value *Layer::forward(Input &input, Value *output) {
+    // Each neuron writes straight into its slot of one buffer, so the concat below is a view
+    std::unique_ptr<Value> buffer;
+    if (!output) {
+        buffer = std::make_unique<Value>(mNOut);
+        output = buffer.get();
+    }
+
     std::vector<Value*> outputs;
-    for (auto &neuron : mNeurons) {
-        outputs.push_back((*neuron)(input));
+    for (size_t i = 0; i < mNOut; i++) {
+        outputs.push_back((*mNeurons[i])(input, output->outputSlice(i, 1)));
     }
     return Value::concat(outputs);
 }
@@ -30,3 +47,15 @@ std::shared_ptr<std::vector<std::shared_ptr<Value>>> Layer::getParameters() {
 
     return result;
 }
+
+size_t Layer::getNIn() const {
+    return mNIn;
+}
+
+size_t Layer::getNOut() const {
+    return mNOut;
+}
+
+Activation Layer::getActivation() const {
+    return mActivation;
+}
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    struct stat status{};
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        throw std::runtime_error("cannot stat " + path);
+    }
+    mSize = static_cast<size_t>(status.st_size);
+
+    // An empty file cannot be mapped, and needs no mapping
+    if (mSize > 0) {
+        void *data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("cannot map " + path);
+        }
+        madvise(data, mSize, MADV_SEQUENTIAL);
+        mData = static_cast<const char *>(data);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (mData) {
+        munmap(const_cast<char *>(mData), mSize);
+    }
+}
+
+const char *MappedFile::getData() const {
+    return mData;
+}
+
+size_t MappedFile::getSize() const {
+    return mSize;
+}
+
+void MappedFile::release(size_t offset) {
+    auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    offset = std::min(offset, mSize) / pageSize * pageSize;
+    if (mData && offset > 0) {
+        madvise(const_cast<char *>(mData), offset, MADV_DONTNEED);
+    }
+}
@@ -1,24 +1,83 @@
 //
 // Created by tom on 20/07/23.
 //
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <stdexcept>
+#include "Curvature.h"
 #include "MultiLayerPerceptron.h"
+#include "SparseValue.h"
+
+MultiLayerPerceptron::MultiLayerPerceptron(size_t nIn, std::vector<size_t> nOuts)
+        : MultiLayerPerceptron(nIn, nOuts, std::vector<Activation>(nOuts.size(), Activation::Tanh)) {
+}
+
+MultiLayerPerceptron::MultiLayerPerceptron(size_t nIn, std::vector<size_t> nOuts, std::vector<Activation> activations) {
+    if (activations.size() != nOuts.size()) {
+        throw std::logic_error("size mismatch");
+    }
 
-MultiLayerPerceptron::MultiLayerPerceptron(size_t nIn, std::vector<size_t> nOuts) {
     auto currIn = nIn;
-    for (auto &nOut : nOuts) {
-        mLayers.push_back(std::make_shared<Layer>(currIn, nOut));
-        currIn = nOut;
+    for (size_t i = 0; i < nOuts.size(); i++) {
+        mLayers.push_back(std::make_shared<Layer>(currIn, nOuts[i], activations[i]));
+        currIn = nOuts[i];
     }
 }
 
-Value *MultiLayerPerceptron::operator()(Value &input) {
-    auto currInput = new Value(input);
-    for (auto &layer : mLayers) {
-        currInput = (*layer)(*currInput);
+Value *MultiLayerPerceptron::operator()(Value &input, Value *output) {
+    auto currInput = &input;
+    for (size_t i = 0; i < mLayers.size(); i++) {
+        currInput = (*mLayers[i])(*currInput, i + 1 == mLayers.size() ? output : nullptr);
+    }
+    return currInput;
+}
+
+Value *MultiLayerPerceptron::operator()(SparseValue &input, Value *output) {
+    if (mLayers.size() == 1) {
+        return (*mLayers[0])(input, output);
+    }
+    auto currInput = (*mLayers[0])(input);
+    for (size_t i = 1; i < mLayers.size(); i++) {
+        currInput = (*mLayers[i])(*currInput, i + 1 == mLayers.size() ? output : nullptr);
     }
     return currInput;
 }
 
+const std::vector<std::shared_ptr<Layer>> &MultiLayerPerceptron::getLayers() const {
+    return mLayers;
+}
+
+std::vector<std::vector<float>> MultiLayerPerceptron::jacobian(Value &input) {
+    Value::NoGrad noGrad;
+
+    // One pass per input direction; cheap when the network has few inputs
+    Value point(input);
+    auto direction = point.getTangentSpan();
+    auto nIn = point.getSize();
+    std::vector<std::vector<float>> result;
+
+    for (size_t j = 0; j < nIn; j++) {
+        std::fill(direction.begin(), direction.end(), 0.0f);
+        direction[j] = 1.0f;
+
+        auto output = (*this)(point);
+        auto tangent = output->getTangentSpan();
+        result.resize(tangent.size(), std::vector<float>(nIn));
+        for (size_t i = 0; i < tangent.size(); i++) {
+            result[i][j] = tangent[i];
+        }
+    }
+
+    return result;
+}
+
+std::vector<float> MultiLayerPerceptron::hessianVectorProduct(const std::function<Value *()> &objective,
+                                                              const std::vector<float> &v) {
+    return Curvature::hessianVectorProduct(*getParameters(), objective, v);
+}
+
 std::shared_ptr<std::vector<std::shared_ptr<Value>>> MultiLayerPerceptron::getParameters() {
     auto result = std::make_shared<std::vector<std::shared_ptr<Value>>>(std::vector<std::shared_ptr<Value>>());
 
@@ -29,3 +88,165 @@ std::shared_ptr<std::vector<std::shared_ptr<Value>>> MultiLayerPerceptron::getPa
 
     return result;
 }
+
+namespace {
+    // "smolgrad model", format version 1; integers and floats are stored in host byte order
+    constexpr char kMagic[8] = {'S', 'M', 'O', 'L', 'G', 'M', 'D', 'L'};
+    constexpr uint32_t kVersion = 1;
+
+    template<typename T>
+    void writeRaw(std::ostream &os, const T &value) {
+        os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    T readRaw(std::istream &is) {
+        T value;
+        if (!is.read(reinterpret_cast<char *>(&value), sizeof(T))) {
+            throw std::runtime_error("truncated model file");
+        }
+        return value;
+    }
+}
+
+void MultiLayerPerceptron::save(std::ostream &os) {
+    if (mLayers.empty()) {
+        throw std::logic_error("empty network");
+    }
+
+    os.write(kMagic, sizeof(kMagic));
+    writeRaw(os, kVersion);
+    writeRaw(os, static_cast<uint64_t>(mLayers.front()->getNIn()));
+    writeRaw(os, static_cast<uint64_t>(mLayers.size()));
+    for (auto &layer: mLayers) {
+        writeRaw(os, static_cast<uint64_t>(layer->getNOut()));
+        writeRaw(os, static_cast<uint32_t>(layer->getActivation()));
+    }
+
+    auto parameters = getParameters();
+    for (auto &parameter: *parameters) {
+        auto data = parameter->getDataSpan();
+        os.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(float)));
+    }
+    if (!os) {
+        throw std::runtime_error("failed to write model file");
+    }
+}
+
+MultiLayerPerceptron MultiLayerPerceptron::load(std::istream &is) {
+    char magic[sizeof(kMagic)];
+    if (!is.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("not a model file");
+    }
+    if (readRaw<uint32_t>(is) != kVersion) {
+        throw std::runtime_error("unsupported model file version");
+    }
+
+    auto nIn = static_cast<size_t>(readRaw<uint64_t>(is));
+    auto nLayers = static_cast<size_t>(readRaw<uint64_t>(is));
+    std::vector<size_t> nOuts;
+    std::vector<Activation> activations;
+    for (size_t i = 0; i < nLayers; i++) {
+        nOuts.push_back(static_cast<size_t>(readRaw<uint64_t>(is)));
+        auto activation = readRaw<uint32_t>(is);
+        if (activation > static_cast<uint32_t>(Activation::Sigmoid)) {
+            throw std::runtime_error("unknown activation in model file");
+        }
+        activations.push_back(static_cast<Activation>(activation));
+    }
+
+    MultiLayerPerceptron model(nIn, nOuts, activations);
+    auto parameters = model.getParameters();
+    for (auto &parameter: *parameters) {
+        auto data = parameter->getDataSpan();
+        if (!is.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(float)))) {
+            throw std::runtime_error("truncated model file");
+        }
+    }
+    return model;
+}
+
+void MultiLayerPerceptron::generateHeader(std::ostream &os, const std::string &name) {
+    if (mLayers.empty()) {
+        throw std::logic_error("empty network");
+    }
+
+    auto nIn = mLayers.front()->getNIn();
+    auto nOut = mLayers.back()->getNOut();
+    auto detail = name + "_detail";
+
+    os << "// Generated by smolgrad from a trained MultiLayerPerceptron; do not edit.\n"
+       << "#pragma once\n\n"
+       << "#include <cmath>\n"
+       << "#include <cstddef>\n\n"
+       << "namespace " << detail << " {\n"
+       << "    template <int Activation>\n"
+       << "    inline float activate(float x) {\n"
+       << "        "
+#define SMOLGRAD_EMIT_ACTIVATION(name, formula) \
+       << "if constexpr (Activation == " << static_cast<int>(Activation::name) << ") {\n" \
+       << "            return " #formula ";\n" \
+       << "        } else "
+       SMOLGRAD_ACTIVATIONS(SMOLGRAD_EMIT_ACTIVATION)
+#undef SMOLGRAD_EMIT_ACTIVATION
+       << "{\n"
+       << "            static_assert(Activation < 0, \"unknown activation\");\n"
+       << "            return x;\n"
+       << "        }\n"
+       << "    }\n\n"
+       << "    // Loop bounds are compile-time constants, so the compiler can unroll and vectorise them\n"
+       << "    template <std::size_t NIn, std::size_t NOut, int Activation>\n"
+       << "    inline void layer(const float (&weights)[NOut][NIn], const float (&bias)[NOut],\n"
+       << "                      const float (&input)[NIn], float (&output)[NOut]) {\n"
+       << "        for (std::size_t o = 0; o < NOut; ++o) {\n"
+       << "            float sum = 0.0f;\n"
+       << "            for (std::size_t i = 0; i < NIn; ++i) {\n"
+       << "                sum += weights[o][i] * input[i];\n"
+       << "            }\n"
+       << "            output[o] = activate<Activation>(sum + bias[o]);\n"
+       << "        }\n"
+       << "    }\n";
+
+    // Hexadecimal literals round-trip every weight exactly
+    auto flags = os.flags();
+    os << std::hexfloat;
+    for (size_t l = 0; l < mLayers.size(); l++) {
+        auto parameters = mLayers[l]->getParameters();
+        auto layerIn = mLayers[l]->getNIn();
+        auto layerOut = mLayers[l]->getNOut();
+
+        os << "\n    constexpr float weights" << l << "[" << layerOut << "][" << layerIn << "] = {\n";
+        for (size_t o = 0; o < layerOut; o++) {
+            os << "        {";
+            auto weight = (*parameters)[2 * o]->getDataSpan();
+            for (size_t i = 0; i < layerIn; i++) {
+                os << (i ? ", " : "") << weight[i] << "f";
+            }
+            os << "},\n";
+        }
+        os << "    };\n";
+
+        os << "    constexpr float bias" << l << "[" << layerOut << "] = {";
+        for (size_t o = 0; o < layerOut; o++) {
+            os << (o ? ", " : "") << (*parameters)[2 * o + 1]->at(0) << "f";
+        }
+        os << "};\n";
+    }
+    os.flags(flags);
+
+    os << "}\n\n"
+       << "constexpr std::size_t " << name << "_inputs = " << nIn << ";\n"
+       << "constexpr std::size_t " << name << "_outputs = " << nOut << ";\n\n"
+       << "inline void " << name << "(const float (&input)[" << nIn << "], float (&output)[" << nOut << "]) {\n";
+    for (size_t l = 0; l + 1 < mLayers.size(); l++) {
+        os << "    float activations" << l << "[" << mLayers[l]->getNOut() << "];\n";
+    }
+    for (size_t l = 0; l < mLayers.size(); l++) {
+        os << "    " << detail << "::layer<" << mLayers[l]->getNIn() << ", " << mLayers[l]->getNOut() << ", "
+           << static_cast<int>(mLayers[l]->getActivation()) << ">("
+           << detail << "::weights" << l << ", " << detail << "::bias" << l << ", "
+           << (l == 0 ? "input" : "activations" + std::to_string(l - 1)) << ", "
+           << (l + 1 == mLayers.size() ? "output" : "activations" + std::to_string(l)) << ");\n";
+    }
+    os << "}\n";
+}
@@ -2,15 +2,36 @@
 // Created by tom on 06/07/23.
 //
 #include "Neuron.h"
+#include "SparseValue.h"
 
-Neuron::Neuron(size_t nIn) : mNIn(nIn), mWeight(std::make_shared<Value>(Value::rand(nIn, -1.0f, 1.0f))), mBias(std::make_shared<Value>(Value::rand(1, -1.0f, 1.0f))) {
+Neuron::Neuron(size_t nIn, Activation activation) : mNIn(nIn), mActivation(activation), mWeight(std::make_shared<Value>(Value::rand(nIn, -1.0f, 1.0f))), mBias(std::make_shared<Value>(Value::rand(1, -1.0f, 1.0f))) {
 
 }
 
-Value* Neuron::operator()(Value &input) {
+Value* Neuron::operator()(Value &input, Value *output) {
     auto c = mWeight->dot(input);
     auto d = *c + *mBias;
-    return d->tanh();
+    return activate(d, mActivation, output);
+}
+
+Value* Neuron::operator()(SparseValue &input, Value *output) {
+    auto c = mWeight->dot(input);
+    auto d = *c + *mBias;
+    return activate(d, mActivation, output);
+}
+
+Value* activate(Value *d, Activation activation, Value *output) {
+    switch (activation) {
+        case Activation::Tanh:
+            return d->tanh(output);
+        case Activation::ReLU:
+            return d->relu(output);
+        case Activation::GELU:
+            return d->gelu(output);
+        case Activation::Sigmoid:
+            return d->sigmoid(output);
+    }
+    throw std::logic_error("unknown activation");
 }
 
 std::shared_ptr<std::vector<std::shared_ptr<Value>>> Neuron::getParameters() {
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cmath>
+#include "NewtonCG.h"
+
+NewtonCG::NewtonCG(std::shared_ptr<Curvature::Parameters> parameters, size_t maxIterations, float damping)
+        : mParameters(std::move(parameters)), mMaxIterations(maxIterations), mDamping(damping) {
+}
+
+float NewtonCG::step(const Curvature::Objective &objective) {
+    auto &parameters = *mParameters;
+    std::vector<float> gradient;
+    float loss = Curvature::gradient(parameters, objective, gradient);
+    size_t n = gradient.size();
+
+    // Conjugate gradients on (H + damping I) p = -g, to a tolerance relative to |g|
+    float gradientNorm = std::sqrt(Curvature::dot(gradient, gradient));
+    float tolerance = std::min(0.5f, std::sqrt(gradientNorm)) * gradientNorm;
+    std::vector<float> p(n, 0.0f);
+    std::vector<float> residual(n);
+    for (size_t i = 0; i < n; ++i) {
+        residual[i] = -gradient[i];
+    }
+    std::vector<float> direction(residual);
+    float residualNorm = Curvature::dot(residual, residual);
+
+    for (size_t iteration = 0; iteration < mMaxIterations && std::sqrt(residualNorm) > tolerance; ++iteration) {
+        auto product = Curvature::hessianVectorProduct(parameters, objective, direction);
+        for (size_t i = 0; i < n; ++i) {
+            product[i] += mDamping * direction[i];
+        }
+        float curvature = Curvature::dot(direction, product);
+        if (curvature <= 0.0f) {
+            if (iteration == 0) {
+                p = residual;
+            }
+            break;
+        }
+
+        float alpha = residualNorm / curvature;
+        for (size_t i = 0; i < n; ++i) {
+            p[i] += alpha * direction[i];
+            residual[i] -= alpha * product[i];
+        }
+        float nextNorm = Curvature::dot(residual, residual);
+        float beta = nextNorm / residualNorm;
+        for (size_t i = 0; i < n; ++i) {
+            direction[i] = residual[i] + beta * direction[i];
+        }
+        residualNorm = nextNorm;
+    }
+
+    // Backtracking line search along p; with no acceptable step the parameters stay put
+    float slope = Curvature::dot(gradient, p);
+    float t = 1.0f;
+    Curvature::lineSearch(parameters, p, loss, slope, [&]() { return Curvature::loss(objective); }, t);
+    return loss;
+}
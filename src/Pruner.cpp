@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "Pruner.h"
+
+Pruner::Pruner(MultiLayerPerceptron &model) : mLayers(model.getLayers().size()) {
+    auto &layers = model.getLayers();
+    for (size_t l = 0; l < layers.size(); l++) {
+        // Parameters come in (weight, bias) pairs per neuron
+        auto parameters = layers[l]->getParameters();
+        for (size_t p = 0; p < parameters->size(); p += 2) {
+            auto &weight = (*parameters)[p];
+            mMasks.push_back({weight, std::vector<bool>(weight->getSize(), false), l});
+        }
+    }
+}
+
+void Pruner::pruneGlobal(float sparsity) {
+    prune(sparsity, nullptr);
+}
+
+void Pruner::pruneLayers(const std::vector<float> &sparsities) {
+    if (sparsities.size() != mLayers) {
+        throw std::logic_error("size mismatch");
+    }
+    for (size_t l = 0; l < mLayers; l++) {
+        prune(sparsities[l], &l);
+    }
+}
+
+void Pruner::prune(float sparsity, const size_t *layer) {
+    if (sparsity < 0.0f || sparsity > 1.0f) {
+        throw std::out_of_range("sparsity out of range");
+    }
+
+    // (magnitude, mask, index) of every candidate weight; already pruned ones count towards the target
+    struct Candidate {
+        float magnitude;
+        size_t mask;
+        size_t index;
+    };
+    std::vector<Candidate> candidates;
+    for (size_t m = 0; m < mMasks.size(); m++) {
+        if (layer && mMasks[m].layer != *layer) {
+            continue;
+        }
+        auto data = mMasks[m].weight->getDataSpan();
+        for (size_t i = 0; i < data.size(); i++) {
+            candidates.push_back({mMasks[m].pruned[i] ? 0.0f : std::fabs(data[i]), m, i});
+        }
+    }
+
+    auto count = static_cast<size_t>(sparsity * static_cast<float>(candidates.size()));
+    std::nth_element(candidates.begin(), candidates.begin() + count, candidates.end(),
+                     [](const Candidate &a, const Candidate &b) { return a.magnitude < b.magnitude; });
+    for (size_t c = 0; c < count; c++) {
+        mMasks[candidates[c].mask].pruned[candidates[c].index] = true;
+    }
+    applyMask();
+}
+
+void Pruner::applyMask() {
+    for (auto &mask: mMasks) {
+        auto data = mask.weight->getDataSpan();
+        for (size_t i = 0; i < data.size(); i++) {
+            if (mask.pruned[i]) {
+                data[i] = 0.0f;
+            }
+        }
+        mask.weight->markModified();
+    }
+}
+
+float Pruner::getSparsity() const {
+    size_t pruned = 0;
+    size_t total = 0;
+    for (auto &mask: mMasks) {
+        pruned += std::count(mask.pruned.begin(), mask.pruned.end(), true);
+        total += mask.pruned.size();
+    }
+    return total ? static_cast<float>(pruned) / static_cast<float>(total) : 0.0f;
+}
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "Random.h"
+#include "ThreadAffinity.h"
+
+namespace {
+    constexpr uint32_t kMultiplier0 = 0xD2511F53;
+    constexpr uint32_t kMultiplier1 = 0xCD9E8D57;
+    constexpr uint32_t kWeyl0 = 0x9E3779B9;
+    constexpr uint32_t kWeyl1 = 0xBB67AE85;
+
+    // Fills below this size are not worth spawning threads for
+    constexpr size_t kParallelThreshold = 1 << 16;
+
+    // Top 24 bits to a float in [0, 1)
+    inline float toUnit(uint32_t word) {
+        return static_cast<float>(word >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // Top 24 bits to a float in (0, 1], safe to take the log of
+    inline float toUnitOpen(uint32_t word) {
+        return static_cast<float>((word >> 8) + 1) * (1.0f / 16777216.0f);
+    }
+
+    // Run `fill(begin, end)` over [0, size) in chunks of whole counter blocks
+    template <typename Fill>
+    void parallelFill(size_t size, size_t threads, Fill fill) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (threads == 1 || size < kParallelThreshold) {
+            fill(0, size);
+            return;
+        }
+
+        size_t blocks = (size + 3) / 4;
+        size_t blocksPerThread = (blocks + threads - 1) / threads;
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            size_t begin = std::min(size, t * blocksPerThread * 4);
+            size_t end = std::min(size, (t + 1) * blocksPerThread * 4);
+            if (begin < end) {
+                workers.emplace_back(fill, begin, end);
+                ThreadAffinity::pin(workers.back(), t);
+            }
+        }
+        for (auto &worker: workers) {
+            worker.join();
+        }
+    }
+}
+
+uint64_t Random::sSeed = 0;
+std::atomic<uint64_t> Random::sStream{0};
+size_t Random::sThreads = 0;
+
+void Random::seed(uint64_t seed) {
+    sSeed = seed;
+    sStream = 0;
+}
+
+void Random::setThreads(size_t threads) {
+    sThreads = threads;
+}
+
+void Random::uniform(Span<float> out, float min, float max) {
+    uniform(out, min, max, sSeed, sStream++, sThreads);
+}
+
+void Random::normal(Span<float> out, float mean, float stddev) {
+    normal(out, mean, stddev, sSeed, sStream++, sThreads);
+}
+
+std::array<uint32_t, 4> Random::philox(uint64_t counter, uint64_t stream, uint64_t key) {
+    uint32_t c0 = static_cast<uint32_t>(counter);
+    uint32_t c1 = static_cast<uint32_t>(counter >> 32);
+    uint32_t c2 = static_cast<uint32_t>(stream);
+    uint32_t c3 = static_cast<uint32_t>(stream >> 32);
+    uint32_t k0 = static_cast<uint32_t>(key);
+    uint32_t k1 = static_cast<uint32_t>(key >> 32);
+
+    for (int round = 0; round < 10; ++round) {
+        uint64_t product0 = static_cast<uint64_t>(kMultiplier0) * c0;
+        uint64_t product1 = static_cast<uint64_t>(kMultiplier1) * c2;
+        uint32_t hi0 = static_cast<uint32_t>(product0 >> 32);
+        uint32_t lo0 = static_cast<uint32_t>(product0);
+        uint32_t hi1 = static_cast<uint32_t>(product1 >> 32);
+        uint32_t lo1 = static_cast<uint32_t>(product1);
+
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+
+        k0 += kWeyl0;
+        k1 += kWeyl1;
+    }
+
+    return {c0, c1, c2, c3};
+}
+
+void Random::uniform(Span<float> out, float min, float max, uint64_t seed, uint64_t stream, size_t threads) {
+    float *data = out.data();
+    float scale = max - min;
+    parallelFill(out.size(), threads, [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += 4) {
+            auto words = philox(i / 4, stream, seed);
+            size_t count = std::min<size_t>(4, end - i);
+            for (size_t j = 0; j < count; ++j) {
+                data[i + j] = min + scale * toUnit(words[j]);
+            }
+        }
+    });
+}
+
+void Random::normal(Span<float> out, float mean, float stddev, uint64_t seed, uint64_t stream, size_t threads) {
+    float *data = out.data();
+    parallelFill(out.size(), threads, [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += 4) {
+            // Box-Muller turns each pair of words into a pair of normals
+            auto words = philox(i / 4, stream, seed);
+            float samples[4];
+            for (size_t j = 0; j < 4; j += 2) {
+                float radius = std::sqrt(-2.0f * std::log(toUnitOpen(words[j])));
+                float angle = 6.28318530718f * toUnit(words[j + 1]);
+                samples[j] = radius * std::cos(angle);
+                samples[j + 1] = radius * std::sin(angle);
+            }
+            size_t count = std::min<size_t>(4, end - i);
+            for (size_t j = 0; j < count; ++j) {
+                data[i + j] = mean + stddev * samples[j];
+            }
+        }
+    });
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "SharedMemoryTransport.h"
+
+namespace {
+    // Floats per channel; four pieces, so a ring of ranks always makes progress
+    constexpr size_t kChannelCapacity = 4 * 4096;
+}
+
+// Counters only ever grow; ftruncate zero-fills a fresh segment, which is their initial state
+struct SharedMemoryTransport::Channel {
+    alignas(64) std::atomic<uint64_t> written;
+    alignas(64) std::atomic<uint64_t> read;
+    alignas(64) float data[kChannelCapacity];
+};
+
+SharedMemoryTransport::SharedMemoryTransport(const std::string &name, size_t rank, size_t worldSize)
+        : mRank(rank), mWorldSize(worldSize), mMapping(nullptr), mMappingSize(sizeof(Channel) * worldSize * worldSize) {
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory counters must be lock-free");
+    if (rank >= worldSize) {
+        throw std::out_of_range("rank out of range");
+    }
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("shm_open failed for " + name);
+    }
+    if (ftruncate(fd, static_cast<off_t>(mMappingSize)) != 0) {
+        close(fd);
+        throw std::runtime_error("ftruncate failed for " + name);
+    }
+    mMapping = mmap(nullptr, mMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mMapping == MAP_FAILED) {
+        throw std::runtime_error("mmap failed for " + name);
+    }
+
+    // Once everyone has the mapping the name is no longer needed
+    barrier();
+    if (rank == 0) {
+        shm_unlink(name.c_str());
+    }
+}
+
+SharedMemoryTransport::~SharedMemoryTransport() {
+    munmap(mMapping, mMappingSize);
+}
+
+size_t SharedMemoryTransport::getRank() const {
+    return mRank;
+}
+
+size_t SharedMemoryTransport::getWorldSize() const {
+    return mWorldSize;
+}
+
+SharedMemoryTransport::Channel *SharedMemoryTransport::channel(size_t from, size_t to) {
+    return static_cast<Channel *>(mMapping) + from * mWorldSize + to;
+}
+
+void SharedMemoryTransport::send(size_t peer, const float *data, size_t size) {
+    auto target = channel(mRank, peer);
+    while (size > 0) {
+        uint64_t written = target->written.load(std::memory_order_relaxed);
+        size_t space;
+        while ((space = kChannelCapacity - (written - target->read.load(std::memory_order_acquire))) == 0) {
+            std::this_thread::yield();
+        }
+
+        size_t count = std::min(space, size);
+        for (size_t i = 0; i < count; ++i) {
+            target->data[(written + i) % kChannelCapacity] = data[i];
+        }
+        target->written.store(written + count, std::memory_order_release);
+
+        data += count;
+        size -= count;
+    }
+}
+
+void SharedMemoryTransport::receive(size_t peer, float *data, size_t size) {
+    auto source = channel(peer, mRank);
+    while (size > 0) {
+        uint64_t read = source->read.load(std::memory_order_relaxed);
+        size_t available;
+        while ((available = source->written.load(std::memory_order_acquire) - read) == 0) {
+            std::this_thread::yield();
+        }
+
+        size_t count = std::min(available, size);
+        for (size_t i = 0; i < count; ++i) {
+            data[i] = source->data[(read + i) % kChannelCapacity];
+        }
+        source->read.store(read + count, std::memory_order_release);
+
+        data += count;
+        size -= count;
+    }
+}
@@ -0,0 +1,53 @@
+#include <stdexcept>
+#include "SparseValue.h"
+
+// Factory methods
+SparseValue SparseValue::fromDense(const Value &value) {
+    std::vector<size_t> indices;
+    std::vector<float> values;
+    for (size_t i = 0; i < value.getSize(); ++i) {
+        if (value[i] != 0.0f) {
+            indices.push_back(i);
+            values.push_back(value[i]);
+        }
+    }
+    return {value.getSize(), std::move(indices), std::move(values)};
+}
+
+// Constructor
+SparseValue::SparseValue(size_t size, std::vector<size_t> indices, std::vector<float> values)
+        : mSize(size), mIndices(std::move(indices)), mValues(std::move(values)) {
+    if (mIndices.size() != mValues.size()) {
+        throw std::logic_error("size mismatch");
+    }
+    for (auto index: mIndices) {
+        if (index >= mSize) {
+            throw std::out_of_range("index out of range");
+        }
+    }
+}
+
+// Member function
+size_t SparseValue::getSize() const {
+    return mSize;
+}
+
+size_t SparseValue::getNonZeros() const {
+    return mIndices.size();
+}
+
+const std::vector<size_t> &SparseValue::getIndices() const {
+    return mIndices;
+}
+
+const std::vector<float> &SparseValue::getValues() const {
+    return mValues;
+}
+
+Value SparseValue::toDense() const {
+    Value result(mSize);
+    for (size_t k = 0; k < mIndices.size(); ++k) {
+        result[mIndices[k]] += mValues[k];
+    }
+    return result;
+}
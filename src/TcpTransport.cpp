@@ -0,0 +1,140 @@
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "TcpTransport.h"
+
+namespace {
+    // How long to keep retrying a peer that is not listening yet
+    constexpr auto kConnectTimeout = std::chrono::seconds(30);
+
+    void writeAll(int socket, const void *data, size_t size) {
+        auto bytes = static_cast<const char *>(data);
+        while (size > 0) {
+            auto written = ::send(socket, bytes, size, MSG_NOSIGNAL);
+            if (written <= 0) {
+                throw std::runtime_error("tcp send failed");
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    void readAll(int socket, void *data, size_t size) {
+        auto bytes = static_cast<char *>(data);
+        while (size > 0) {
+            auto received = ::recv(socket, bytes, size, 0);
+            if (received <= 0) {
+                throw std::runtime_error("tcp connection closed");
+            }
+            bytes += received;
+            size -= static_cast<size_t>(received);
+        }
+    }
+
+    sockaddr_in address(const std::string &host, uint16_t port) {
+        sockaddr_in result{};
+        result.sin_family = AF_INET;
+        result.sin_port = htons(port);
+        if (inet_pton(AF_INET, host.c_str(), &result.sin_addr) != 1) {
+            throw std::runtime_error("invalid address " + host);
+        }
+        return result;
+    }
+
+    void setNoDelay(int socket) {
+        int one = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+}
+
+TcpTransport::TcpTransport(size_t rank, std::vector<std::string> hosts, uint16_t basePort)
+        : mRank(rank), mHosts(std::move(hosts)), mSockets(mHosts.size(), -1) {
+    if (rank >= mHosts.size()) {
+        throw std::out_of_range("rank out of range");
+    }
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(static_cast<uint16_t>(basePort + rank));
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(listener, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0 ||
+        listen(listener, static_cast<int>(mHosts.size())) != 0) {
+        close(listener);
+        throw std::runtime_error("tcp listen failed on port " + std::to_string(basePort + rank));
+    }
+
+    // Connect down, announcing our rank
+    for (size_t peer = 0; peer < rank; ++peer) {
+        auto remote = address(mHosts[peer], static_cast<uint16_t>(basePort + peer));
+        auto deadline = std::chrono::steady_clock::now() + kConnectTimeout;
+        int connection = -1;
+        while (connection < 0) {
+            connection = socket(AF_INET, SOCK_STREAM, 0);
+            if (connect(connection, reinterpret_cast<sockaddr *>(&remote), sizeof(remote)) != 0) {
+                close(connection);
+                connection = -1;
+                if (std::chrono::steady_clock::now() > deadline) {
+                    close(listener);
+                    throw std::runtime_error("tcp connect to rank " + std::to_string(peer) + " timed out");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        setNoDelay(connection);
+        auto announced = static_cast<uint32_t>(rank);
+        writeAll(connection, &announced, sizeof(announced));
+        mSockets[peer] = connection;
+    }
+
+    // Accept up, learning each peer's rank from its announcement
+    for (size_t accepted = rank + 1; accepted < mHosts.size(); ++accepted) {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            close(listener);
+            throw std::runtime_error("tcp accept failed");
+        }
+        setNoDelay(connection);
+        uint32_t peer;
+        readAll(connection, &peer, sizeof(peer));
+        if (peer <= rank || peer >= mHosts.size() || mSockets[peer] >= 0) {
+            close(connection);
+            close(listener);
+            throw std::runtime_error("unexpected tcp peer");
+        }
+        mSockets[peer] = connection;
+    }
+    close(listener);
+}
+
+TcpTransport::~TcpTransport() {
+    for (auto socket: mSockets) {
+        if (socket >= 0) {
+            close(socket);
+        }
+    }
+}
+
+size_t TcpTransport::getRank() const {
+    return mRank;
+}
+
+size_t TcpTransport::getWorldSize() const {
+    return mHosts.size();
+}
+
+void TcpTransport::send(size_t peer, const float *data, size_t size) {
+    writeAll(mSockets.at(peer), data, size * sizeof(float));
+}
+
+void TcpTransport::receive(size_t peer, float *data, size_t size) {
+    readAll(mSockets.at(peer), data, size * sizeof(float));
+}
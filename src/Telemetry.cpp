@@ -0,0 +1,220 @@
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include "Allocator.h"
+#include "Telemetry.h"
+#include "Value.h"
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+namespace {
+    // JSON has no NaN or infinity, and a diverging run is exactly when the line matters
+    struct JsonNumber {
+        double value;
+    };
+
+    std::ostream &operator<<(std::ostream &os, JsonNumber number) {
+        if (!std::isfinite(number.value)) {
+            return os << "null";
+        }
+        return os << number.value;
+    }
+
+    // The text exposition format spells them NaN, +Inf and -Inf
+    struct PrometheusNumber {
+        double value;
+    };
+
+    std::ostream &operator<<(std::ostream &os, PrometheusNumber number) {
+        if (std::isnan(number.value)) {
+            return os << "NaN";
+        }
+        if (std::isinf(number.value)) {
+            return os << (number.value > 0.0 ? "+Inf" : "-Inf");
+        }
+        return os << number.value;
+    }
+}
+
+Telemetry::Telemetry(Options options) : mOptions(std::move(options)) {
+    mJson.open(mOptions.jsonPath, std::ios::app);
+    if (!mJson) {
+        throw std::runtime_error("cannot open " + mOptions.jsonPath);
+    }
+    mFileBytes = static_cast<size_t>(mJson.tellp());
+    mWriter = std::thread(&Telemetry::run, this);
+}
+
+Telemetry::~Telemetry() {
+    mStopping = true;
+    mWriter.join();
+}
+
+void Telemetry::record(Step step) {
+    step.liveValues = Value::getLiveCount();
+    step.liveBytes = Allocator::getLiveBytes();
+    if (mQueue.push(step)) {
+        mRecorded.fetch_add(1, std::memory_order_release);
+    } else {
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Telemetry::flush() {
+    while (mWritten.load(std::memory_order_acquire) != mRecorded.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+size_t Telemetry::getDropped() const {
+    return mDropped.load(std::memory_order_relaxed);
+}
+
+float Telemetry::gradientNorm(const std::vector<std::shared_ptr<Value>> &parameters) {
+    // Read without getGradSpan(), which would fold sparse gradients into a dense buffer
+    // and turn the next sparse step() into a dense one
+    double sum = 0.0;
+    for (auto &parameter: parameters) {
+        std::unordered_map<size_t, float> sparse;
+        for (auto &entry: parameter->getSparseGrad()) {
+            sparse[entry.first] += entry.second;
+        }
+        auto dense = parameter->getDenseGradSpan();
+        for (size_t i = 0; i < dense.size(); ++i) {
+            float grad = dense[i];
+            if (!sparse.empty()) {
+                auto found = sparse.find(i);
+                if (found != sparse.end()) {
+                    grad += found->second;
+                    sparse.erase(found);
+                }
+            }
+            sum += static_cast<double>(grad) * grad;
+        }
+        for (auto &entry: sparse) {
+            sum += static_cast<double>(entry.second) * entry.second;
+        }
+    }
+    return static_cast<float>(std::sqrt(sum));
+}
+
+size_t Telemetry::getPeakRss() {
+#ifdef __unix__
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    // Reported in kilobytes on Linux
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#else
+    return 0;
+#endif
+}
+
+double Telemetry::secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Telemetry::run() {
+    while (true) {
+        // Read the flag first so nothing recorded before the destructor is missed
+        bool stopping = mStopping.load();
+        Step step;
+        bool any = false;
+        while (mQueue.pop(step)) {
+            write(step);
+            any = true;
+            mWritten.fetch_add(1, std::memory_order_release);
+        }
+        if (any) {
+            mJson.flush();
+            writePrometheus(step);
+        }
+        if (stopping) {
+            return;
+        }
+        std::this_thread::sleep_for(mOptions.flushInterval);
+    }
+}
+
+void Telemetry::write(const Step &step) {
+    double seconds = step.forwardSeconds + step.backwardSeconds + step.optimizerSeconds;
+    mTotalSamples += step.samples;
+
+    std::ostringstream line;
+    line << "{\"step\":" << step.step
+         << ",\"samples\":" << step.samples
+         << ",\"samples_per_second\":" << (seconds > 0.0 ? step.samples / seconds : 0.0)
+         << ",\"forward_seconds\":" << step.forwardSeconds
+         << ",\"backward_seconds\":" << step.backwardSeconds
+         << ",\"optimizer_seconds\":" << step.optimizerSeconds
+         << ",\"loss\":" << JsonNumber{step.loss}
+         << ",\"gradient_norm\":" << JsonNumber{step.gradientNorm}
+         << ",\"live_values\":" << step.liveValues
+         << ",\"live_bytes\":" << step.liveBytes
+         << ",\"peak_rss_bytes\":" << getPeakRss()
+         << "}\n";
+    auto text = line.str();
+
+    if (mFileBytes > 0 && mFileBytes + text.size() > mOptions.maxFileBytes) {
+        rotate();
+    }
+    mJson << text;
+    mFileBytes += text.size();
+}
+
+void Telemetry::rotate() {
+    // metrics.jsonl.<n-1> -> metrics.jsonl.<n>, ..., metrics.jsonl -> metrics.jsonl.1
+    mJson.close();
+    if (mOptions.maxFiles == 0) {
+        std::remove(mOptions.jsonPath.c_str());
+    } else {
+        std::remove((mOptions.jsonPath + "." + std::to_string(mOptions.maxFiles)).c_str());
+        for (size_t i = mOptions.maxFiles; i > 1; --i) {
+            std::rename((mOptions.jsonPath + "." + std::to_string(i - 1)).c_str(),
+                        (mOptions.jsonPath + "." + std::to_string(i)).c_str());
+        }
+        std::rename(mOptions.jsonPath.c_str(), (mOptions.jsonPath + ".1").c_str());
+    }
+    mJson.open(mOptions.jsonPath, std::ios::trunc);
+    mFileBytes = 0;
+}
+
+void Telemetry::writePrometheus(const Step &step) {
+    double seconds = step.forwardSeconds + step.backwardSeconds + step.optimizerSeconds;
+
+    // Written aside and renamed, so readers never see a partial file
+    auto temporary = mOptions.prometheusPath + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        auto gauge = [&out](const char *name, const char *help, double value) {
+            out << "# HELP smolgrad_" << name << " " << help << "\n"
+                << "# TYPE smolgrad_" << name << " gauge\n"
+                << "smolgrad_" << name << " " << PrometheusNumber{value} << "\n";
+        };
+        auto counter = [&out](const char *name, const char *help, double value) {
+            out << "# HELP smolgrad_" << name << " " << help << "\n"
+                << "# TYPE smolgrad_" << name << " counter\n"
+                << "smolgrad_" << name << " " << value << "\n";
+        };
+        counter("steps_total", "Training steps written.", static_cast<double>(mWritten.load()));
+        counter("samples_total", "Training samples processed.", mTotalSamples);
+        counter("telemetry_dropped_total", "Steps dropped because the telemetry queue was full.",
+                static_cast<double>(getDropped()));
+        gauge("step", "Index of the latest step.", static_cast<double>(step.step));
+        gauge("samples_per_second", "Throughput of the latest step.", seconds > 0.0 ? step.samples / seconds : 0.0);
+        out << "# HELP smolgrad_step_seconds Time spent in each phase of the latest step.\n"
+            << "# TYPE smolgrad_step_seconds gauge\n"
+            << "smolgrad_step_seconds{phase=\"forward\"} " << step.forwardSeconds << "\n"
+            << "smolgrad_step_seconds{phase=\"backward\"} " << step.backwardSeconds << "\n"
+            << "smolgrad_step_seconds{phase=\"optimizer\"} " << step.optimizerSeconds << "\n";
+        gauge("loss", "Loss of the latest step.", step.loss);
+        gauge("gradient_norm", "L2 norm of the parameter gradients.", step.gradientNorm);
+        gauge("live_values", "Values alive, graph nodes included.", static_cast<double>(step.liveValues));
+        gauge("live_bytes", "Bytes held by Value buffers.", static_cast<double>(step.liveBytes));
+        gauge("peak_rss_bytes", "Peak resident set size.", static_cast<double>(getPeakRss()));
+    }
+    std::rename(temporary.c_str(), mOptions.prometheusPath.c_str());
+}
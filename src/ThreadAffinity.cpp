@@ -0,0 +1,87 @@
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include "ThreadAffinity.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+#ifdef __linux__
+    void setAffinity(pthread_t thread, size_t cpu) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(thread, sizeof(set), &set);
+    }
+#endif
+}
+
+namespace {
+    // setCpus() swaps in a new list, so a reader keeps the one it copied alive
+    struct Configuration {
+        std::mutex mutex;
+        std::shared_ptr<const std::vector<size_t>> cpus;
+    };
+
+    Configuration &configuration() {
+        static Configuration configuration{{}, []() {
+            auto value = std::getenv("SMOLGRAD_CPUS");
+            return std::make_shared<const std::vector<size_t>>(
+                    value ? ThreadAffinity::parseCpus(value) : std::vector<size_t>());
+        }()};
+        return configuration;
+    }
+}
+
+std::shared_ptr<const std::vector<size_t>> ThreadAffinity::cpus() {
+    auto &config = configuration();
+    std::lock_guard<std::mutex> lock(config.mutex);
+    return config.cpus;
+}
+
+void ThreadAffinity::setCpus(std::vector<size_t> cpus) {
+    auto snapshot = std::make_shared<const std::vector<size_t>>(std::move(cpus));
+    auto &config = configuration();
+    std::lock_guard<std::mutex> lock(config.mutex);
+    config.cpus = std::move(snapshot);
+}
+
+std::vector<size_t> ThreadAffinity::parseCpus(const std::string &list) {
+    std::vector<size_t> result;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        auto dash = range.find('-');
+        size_t first = std::stoul(range.substr(0, dash));
+        size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+        for (size_t cpu = first; cpu <= last; ++cpu) {
+            result.push_back(cpu);
+        }
+    }
+    return result;
+}
+
+void ThreadAffinity::pin(std::thread &thread, size_t worker) {
+#ifdef __linux__
+    auto configured = cpus();
+    if (!configured->empty()) {
+        setAffinity(thread.native_handle(), (*configured)[worker % configured->size()]);
+    }
+#endif
+}
+
+void ThreadAffinity::pinCurrent(size_t worker) {
+#ifdef __linux__
+    auto configured = cpus();
+    if (!configured->empty()) {
+        setAffinity(pthread_self(), (*configured)[worker % configured->size()]);
+    }
+#endif
+}
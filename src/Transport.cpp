@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <vector>
+#include "Transport.h"
+
+void Transport::sendReceive(size_t sendPeer, const float *sendData, size_t sendSize,
+                            size_t receivePeer, float *receiveData, size_t receiveSize) {
+    for (size_t offset = 0; offset < std::max(sendSize, receiveSize); offset += kPieceSize) {
+        if (offset < sendSize) {
+            send(sendPeer, sendData + offset, std::min(kPieceSize, sendSize - offset));
+        }
+        if (offset < receiveSize) {
+            receive(receivePeer, receiveData + offset, std::min(kPieceSize, receiveSize - offset));
+        }
+    }
+}
+
+void Transport::allReduce(Span<float> data) {
+    size_t worldSize = getWorldSize();
+    if (worldSize == 1) {
+        return;
+    }
+
+    size_t rank = getRank();
+    size_t next = (rank + 1) % worldSize;
+    size_t previous = (rank + worldSize - 1) % worldSize;
+
+    // Chunk c covers [bounds[c], bounds[c + 1])
+    std::vector<size_t> bounds(worldSize + 1);
+    for (size_t c = 0; c <= worldSize; ++c) {
+        bounds[c] = data.size() * c / worldSize;
+    }
+    std::vector<float> incoming(bounds[1] - bounds[0] + 1);
+
+    // Reduce-scatter: after worldSize - 1 steps, rank r holds the full sum of chunk r + 1
+    for (size_t step = 0; step + 1 < worldSize; ++step) {
+        size_t sendChunk = (rank + worldSize - step) % worldSize;
+        size_t receiveChunk = (rank + worldSize - step - 1) % worldSize;
+        size_t receiveSize = bounds[receiveChunk + 1] - bounds[receiveChunk];
+        sendReceive(next, data.data() + bounds[sendChunk], bounds[sendChunk + 1] - bounds[sendChunk],
+                    previous, incoming.data(), receiveSize);
+        for (size_t i = 0; i < receiveSize; ++i) {
+            data[bounds[receiveChunk] + i] += incoming[i];
+        }
+    }
+
+    // Allgather: pass the completed chunks around the ring
+    for (size_t step = 0; step + 1 < worldSize; ++step) {
+        size_t sendChunk = (rank + 1 + worldSize - step) % worldSize;
+        size_t receiveChunk = (rank + worldSize - step) % worldSize;
+        sendReceive(next, data.data() + bounds[sendChunk], bounds[sendChunk + 1] - bounds[sendChunk],
+                    previous, data.data() + bounds[receiveChunk], bounds[receiveChunk + 1] - bounds[receiveChunk]);
+    }
+
+    float scale = 1.0f / static_cast<float>(worldSize);
+    for (auto &x: data) {
+        x *= scale;
+    }
+}
+
+void Transport::barrier() {
+    // One element per rank, so every step of the ring actually exchanges data
+    std::vector<float> tokens(getWorldSize());
+    allReduce({tokens.data(), tokens.size()});
+}
@@ -2,11 +2,25 @@
 #include <cmath>
 #include <cstddef>
 #include <iostream>
+#include <unordered_map>
 #include <unordered_set>
-#include <random>
 #include <stdexcept>
+#include "Random.h"
+#include "SparseValue.h"
 #include "Value.h"
 
+size_t Value::sGradGeneration = 1;
+thread_local bool Value::sGradEnabled = true;
+
+// Gradient mode
+Value::NoGrad::NoGrad() : mPrevious(sGradEnabled) {
+    sGradEnabled = false;
+}
+
+Value::NoGrad::~NoGrad() {
+    sGradEnabled = mPrevious;
+}
+
 // Factory methods
 Value Value::constant(size_t size, float value) {
     Value constant(size);
@@ -19,72 +33,126 @@ Value Value::constant(size_t size, float value) {
 }
 
 Value Value::rand(size_t size, float min, float max) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dis(min, max);
-
     Value rand(size);
-
-    for (size_t i = 0; i < size; ++i) {
-        rand.mData[i] = dis(gen);
-    }
+    Random::uniform(rand.getDataSpan(), min, max);
 
     return rand;
 }
 
 Value Value::randn(size_t size, float mean, float stddev) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::normal_distribution<float> dis(mean, stddev);
-
     Value randn(size);
+    Random::normal(randn.getDataSpan(), mean, stddev);
 
-    for (size_t i = 0; i < size; ++i) {
-        randn.mData[i] = dis(gen);
+    return randn;
+}
+
+// Census
+std::atomic<size_t> Value::sLiveCount{0};
+
+Value::Census::Census() {
+    sLiveCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+Value::Census::Census(const Census &) : Census() {
+}
+
+Value::Census::~Census() {
+    sLiveCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+size_t Value::getLiveCount() {
+    return sLiveCount.load(std::memory_order_relaxed);
+}
+
+size_t Value::getVersion() const {
+    return mStorage ? mStorage->version.load(std::memory_order_acquire) : 0;
+}
+
+void Value::markModified() {
+    if (mStorage) {
+        mStorage->version.store(mStorage->version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
     }
+}
 
-    return randn;
+// Storage
+Value::Storage::Storage(size_t size) : data(Allocator::allocate(size)), size(size) {
 }
 
 // Constructor
 Value::Value(size_t size)
-        : mData(new float[size]()), mGrad(new float[size]()), mSize(size)  // Initialize `value` with `initialValue`
+        : mStorage(std::make_shared<Storage>(size)), mData(mStorage->data.get()), mSize(size)  // Initialize `value` with `initialValue`
 {
 }
 
 Value::Value(std::initializer_list<float> values)
-        : mData(new float[values.size()]), mGrad(new float[values.size()]()), mSize(values.size()) {
+        : Value(values.size()) {
     std::copy(values.begin(), values.end(), &mData[0]);
 }
 
 Value::Value(size_t size, std::initializer_list<Value *> refs)
-        : mData(new float[size]()), mGrad(new float[size]()), mSize(size), mReferences(refs) {
-
+        : Value(size) {
+    setReferences(refs);
 }
 
 Value::Value(size_t size, std::vector<Value *> &refs)
-        : mData(new float[size]()), mGrad(new float[size]()), mSize(size), mReferences(refs) {
-
+        : Value(size) {
+    setReferences(refs);
 }
 
 Value::Value(size_t size, float *values)
-    : mData(new float[size]()), mGrad(new float[size]()), mSize(size) {
+    : Value(size) {
     std::copy(values, values + size, &mData[0]);
 }
 
+Value::Value(Value &parent, size_t offset, size_t size)
+        : mStorage(parent.mStorage), mData(parent.mData + offset), mSize(size), mOffset(parent.mOffset + offset) {
+}
+
 
 // Copy constructor
 Value::Value(const Value &other)
-        : mData(new float[other.mSize]), mGrad(new float[other.mSize]()), mSize(other.mSize) {
+        : Value(other.mSize) {
+    mRequiresGrad = other.mRequiresGrad;
     std::copy(&other.mData[0], &other.mData[0] + other.mSize, &mData[0]);
-    std::copy(&other.mGrad[0], &other.mGrad[0] + other.mSize, &mGrad[0]);
+    if (other.hasGrad()) {
+        other.addGradTo(gradBuffer());
+    }
+    if (auto otherTangent = other.tangentData()) {
+        std::copy(otherTangent, otherTangent + mSize, tangentBuffer());
+    }
+}
+
+// Move constructor
+Value::Value(Value &&other) noexcept
+        : mStorage(std::move(other.mStorage)), mData(other.mData), mSize(other.mSize), mOffset(other.mOffset),
+          mRequiresGrad(other.mRequiresGrad) {
+    other.mData = nullptr;
+    other.mSize = 0;
+    other.mOffset = 0;
 }
 
 // Copy assignment operator
-Value &Value::operator=(Value other) {
+Value &Value::operator=(const Value &other) {
+    if (this != &other) {
+        *this = Value(other);
+    }
+    return *this;
+}
+
+// Move assignment operator
+Value &Value::operator=(Value &&other) noexcept {
+    std::swap(mStorage, other.mStorage);
     std::swap(mData, other.mData);
-    std::swap(mGrad, other.mGrad);
     std::swap(mSize, other.mSize);
+    std::swap(mOffset, other.mOffset);
+    std::swap(mRequiresGrad, other.mRequiresGrad);
+    // Continue from the replaced storage's count, so versions never go backwards
+    if (mStorage && other.mStorage) {
+        auto previous = other.mStorage->version.load(std::memory_order_relaxed);
+        mStorage->version.store(std::max(previous, mStorage->version.load(std::memory_order_relaxed)),
+                                std::memory_order_relaxed);
+    }
+    markModified();
     return *this;
 }
 
@@ -111,9 +179,34 @@ Value *Value::operator+(Value &other) {
 
     auto result = new Value(mSize, {this, &other});
     result->setBackward([result, this, &other]() {
-        for (size_t i = 0; i < mSize; ++i) {
-            mGrad[i] += result->mGrad[i];
-            other.mGrad[i] += result->mGrad[i];
+        auto resultGrad = result->gradBuffer();
+        if (mRequiresGrad) {
+            auto grad = gradBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                grad[i] += resultGrad[i];
+            }
+        }
+        if (other.mRequiresGrad) {
+            auto otherGrad = other.gradBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                otherGrad[i] += resultGrad[i];
+            }
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        if (auto resultGradTangent = result->gradTangentData()) {
+            if (mRequiresGrad) {
+                auto gradTangent = gradTangentBuffer();
+                for (size_t i = 0; i < mSize; ++i) {
+                    gradTangent[i] += resultGradTangent[i];
+                }
+            }
+            if (other.mRequiresGrad) {
+                auto otherGradTangent = other.gradTangentBuffer();
+                for (size_t i = 0; i < mSize; ++i) {
+                    otherGradTangent[i] += resultGradTangent[i];
+                }
+            }
         }
     });
 
@@ -121,6 +214,16 @@ Value *Value::operator+(Value &other) {
         result->mData[i] = mData[i] + other.mData[i];
     }
 
+    // Forward-mode tangent
+    if (hasTangent() || other.hasTangent()) {
+        auto tangent = tangentData();
+        auto otherTangent = other.tangentData();
+        auto resultTangent = result->tangentBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            resultTangent[i] = (tangent ? tangent[i] : 0.0f) + (otherTangent ? otherTangent[i] : 0.0f);
+        }
+    }
+
     return result;
 }
 
@@ -135,9 +238,39 @@ Value *Value::operator*(Value &other) {
 
     auto result = new Value(mSize, {this, &other});
     result->setBackward([result, this, &other]() {
-        for (size_t i = 0; i < mSize; ++i) {
-            mGrad[i] += result->mGrad[i] * other.mData[i];
-            other.mGrad[i] += result->mGrad[i] * mData[i];
+        auto resultGrad = result->gradBuffer();
+        if (mRequiresGrad) {
+            auto grad = gradBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                grad[i] += resultGrad[i] * other.mData[i];
+            }
+        }
+        if (other.mRequiresGrad) {
+            auto otherGrad = other.gradBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                otherGrad[i] += resultGrad[i] * mData[i];
+            }
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        auto resultGradTangent = result->gradTangentData();
+        auto tangent = tangentData();
+        auto otherTangent = other.tangentData();
+        if (resultGradTangent || tangent || otherTangent) {
+            if (mRequiresGrad) {
+                auto gradTangent = gradTangentBuffer();
+                for (size_t i = 0; i < mSize; ++i) {
+                    gradTangent[i] += (resultGradTangent ? resultGradTangent[i] * other.mData[i] : 0.0f) +
+                                      (otherTangent ? resultGrad[i] * otherTangent[i] : 0.0f);
+                }
+            }
+            if (other.mRequiresGrad) {
+                auto otherGradTangent = other.gradTangentBuffer();
+                for (size_t i = 0; i < mSize; ++i) {
+                    otherGradTangent[i] += (resultGradTangent ? resultGradTangent[i] * mData[i] : 0.0f) +
+                                           (tangent ? resultGrad[i] * tangent[i] : 0.0f);
+                }
+            }
         }
     });
 
@@ -145,6 +278,17 @@ Value *Value::operator*(Value &other) {
         result->mData[i] = mData[i] * other.mData[i];
     }
 
+    // Forward-mode tangent
+    if (hasTangent() || other.hasTangent()) {
+        auto tangent = tangentData();
+        auto otherTangent = other.tangentData();
+        auto resultTangent = result->tangentBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            resultTangent[i] = (tangent ? tangent[i] * other.mData[i] : 0.0f) +
+                               (otherTangent ? otherTangent[i] * mData[i] : 0.0f);
+        }
+    }
+
     return result;
 }
 
@@ -159,8 +303,18 @@ Value *Value::operator-() {
 Value *Value::operator+(float other) {
     auto result = new Value(mSize, {this});
     result->setBackward([result, this]() {
+        auto resultGrad = result->gradBuffer();
+        auto grad = gradBuffer();
         for (size_t i = 0; i < mSize; ++i) {
-            mGrad[i] += result->mGrad[i];
+            grad[i] += resultGrad[i];
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        if (auto resultGradTangent = result->gradTangentData()) {
+            auto gradTangent = gradTangentBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                gradTangent[i] += resultGradTangent[i];
+            }
         }
     });
 
@@ -168,6 +322,14 @@ Value *Value::operator+(float other) {
         result->mData[i] = mData[i] + other;
     }
 
+    // Forward-mode tangent
+    if (auto tangent = tangentData()) {
+        auto resultTangent = result->tangentBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            resultTangent[i] = tangent[i];
+        }
+    }
+
     return result;
 }
 
@@ -178,8 +340,18 @@ Value *Value::operator-(float other) {
 Value *Value::operator*(float other) {
     auto result = new Value(mSize, {this});
     result->setBackward([result, this, other]() {
+        auto resultGrad = result->gradBuffer();
+        auto grad = gradBuffer();
         for (size_t i = 0; i < mSize; ++i) {
-            mGrad[i] += result->mGrad[i] * other;
+            grad[i] += resultGrad[i] * other;
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        if (auto resultGradTangent = result->gradTangentData()) {
+            auto gradTangent = gradTangentBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                gradTangent[i] += resultGradTangent[i] * other;
+            }
         }
     });
 
@@ -187,6 +359,14 @@ Value *Value::operator*(float other) {
         result->mData[i] = mData[i] * other;
     }
 
+    // Forward-mode tangent
+    if (auto tangent = tangentData()) {
+        auto resultTangent = result->tangentBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            resultTangent[i] = tangent[i] * other;
+        }
+    }
+
     return result;
 }
 
@@ -197,8 +377,23 @@ Value *Value::operator/(float other) {
 Value *Value::pow(float exponent) {
     auto result = new Value(mSize, {this});
     result->setBackward([result, this, exponent]() {
+        auto resultGrad = result->gradBuffer();
+        auto grad = gradBuffer();
         for (size_t i = 0; i < mSize; ++i) {
-            mGrad[i] += result->mGrad[i] * exponent * std::pow(mData[i], exponent - 1.0f);
+            grad[i] += resultGrad[i] * exponent * std::pow(mData[i], exponent - 1.0f);
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        auto resultGradTangent = result->gradTangentData();
+        auto tangent = tangentData();
+        if (resultGradTangent || tangent) {
+            auto gradTangent = gradTangentBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                float first = exponent * std::pow(mData[i], exponent - 1.0f);
+                float second = exponent * (exponent - 1.0f) * std::pow(mData[i], exponent - 2.0f);
+                gradTangent[i] += (resultGradTangent ? resultGradTangent[i] * first : 0.0f) +
+                                  (tangent ? resultGrad[i] * second * tangent[i] : 0.0f);
+            }
         }
     });
 
@@ -206,14 +401,36 @@ Value *Value::pow(float exponent) {
         result->mData[i] = std::pow(mData[i], exponent);
     }
 
+    // Forward-mode tangent
+    if (auto tangent = tangentData()) {
+        auto resultTangent = result->tangentBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            resultTangent[i] = tangent[i] * exponent * std::pow(mData[i], exponent - 1.0f);
+        }
+    }
+
     return result;
 }
 
-Value *Value::exp() {
-    auto result = new Value(mSize, {this});
+Value *Value::exp(Value *out) {
+    auto result = makeResult(out, mSize, {this});
     result->setBackward([result, this]() {
+        auto resultGrad = result->gradBuffer();
+        auto grad = gradBuffer();
         for (size_t i = 0; i < mSize; ++i) {
-            mGrad[i] += result->mGrad[i] * result->mData[i];
+            grad[i] += resultGrad[i] * result->mData[i];
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        auto resultGradTangent = result->gradTangentData();
+        auto tangent = tangentData();
+        if (resultGradTangent || tangent) {
+            auto gradTangent = gradTangentBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                float y = result->mData[i];
+                gradTangent[i] += (resultGradTangent ? resultGradTangent[i] * y : 0.0f) +
+                                  (tangent ? resultGrad[i] * y * tangent[i] : 0.0f);
+            }
         }
     });
 
@@ -221,14 +438,37 @@ Value *Value::exp() {
         result->mData[i] = std::exp(mData[i]);
     }
 
+    // Forward-mode tangent
+    if (auto tangent = tangentData()) {
+        auto resultTangent = result->tangentBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            resultTangent[i] = tangent[i] * result->mData[i];
+        }
+    }
+
     return result;
 }
 
-Value *Value::tanh() {
-    auto result = new Value(mSize, {this});
+Value *Value::tanh(Value *out) {
+    auto result = makeResult(out, mSize, {this});
     result->setBackward([result, this]() {
+        auto resultGrad = result->gradBuffer();
+        auto grad = gradBuffer();
         for (size_t i = 0; i < mSize; ++i) {
-            mGrad[i] += result->mGrad[i] * (1.0f - result->mData[i] * result->mData[i]);
+            grad[i] += resultGrad[i] * (1.0f - result->mData[i] * result->mData[i]);
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        auto resultGradTangent = result->gradTangentData();
+        auto tangent = tangentData();
+        if (resultGradTangent || tangent) {
+            auto gradTangent = gradTangentBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                float y = result->mData[i];
+                float first = 1.0f - y * y;
+                gradTangent[i] += (resultGradTangent ? resultGradTangent[i] * first : 0.0f) +
+                                  (tangent ? resultGrad[i] * -2.0f * y * first * tangent[i] : 0.0f);
+            }
         }
     });
 
@@ -236,6 +476,136 @@ Value *Value::tanh() {
         result->mData[i] = std::tanh(mData[i]);
     }
 
+    // Forward-mode tangent
+    if (auto tangent = tangentData()) {
+        auto resultTangent = result->tangentBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            resultTangent[i] = tangent[i] * (1.0f - result->mData[i] * result->mData[i]);
+        }
+    }
+
+    return result;
+}
+
+Value *Value::relu(Value *out) {
+    auto result = makeResult(out, mSize, {this});
+    result->setBackward([result, this]() {
+        auto resultGrad = result->gradBuffer();
+        auto grad = gradBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            grad[i] += mData[i] > 0.0f ? resultGrad[i] : 0.0f;
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        if (auto resultGradTangent = result->gradTangentData()) {
+            auto gradTangent = gradTangentBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                gradTangent[i] += mData[i] > 0.0f ? resultGradTangent[i] : 0.0f;
+            }
+        }
+    });
+
+    for (size_t i = 0; i < mSize; ++i) {
+        result->mData[i] = std::max(mData[i], 0.0f);
+    }
+
+    // Forward-mode tangent
+    if (auto tangent = tangentData()) {
+        auto resultTangent = result->tangentBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            resultTangent[i] = mData[i] > 0.0f ? tangent[i] : 0.0f;
+        }
+    }
+
+    return result;
+}
+
+Value *Value::gelu(Value *out) {
+    // Tanh approximation: 0.5 x (1 + tanh(sqrt(2 / pi) (x + 0.044715 x^3)))
+    constexpr float k = 0.7978845608f;
+    constexpr float c = 0.044715f;
+
+    auto result = makeResult(out, mSize, {this});
+    result->setBackward([result, this]() {
+        auto resultGrad = result->gradBuffer();
+        auto grad = gradBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            float x = mData[i];
+            float t = std::tanh(k * (x + c * x * x * x));
+            float derivative = 0.5f * (1.0f + t) + 0.5f * x * (1.0f - t * t) * k * (1.0f + 3.0f * c * x * x);
+            grad[i] += resultGrad[i] * derivative;
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        auto resultGradTangent = result->gradTangentData();
+        auto tangent = tangentData();
+        if (resultGradTangent || tangent) {
+            auto gradTangent = gradTangentBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                float x = mData[i];
+                float t = std::tanh(k * (x + c * x * x * x));
+                float u = k * (1.0f + 3.0f * c * x * x);
+                float first = 0.5f * (1.0f + t) + 0.5f * x * (1.0f - t * t) * u;
+                float second = (1.0f - t * t) * (u + 0.5f * x * (6.0f * k * c * x - 2.0f * t * u * u));
+                gradTangent[i] += (resultGradTangent ? resultGradTangent[i] * first : 0.0f) +
+                                  (tangent ? resultGrad[i] * second * tangent[i] : 0.0f);
+            }
+        }
+    });
+
+    for (size_t i = 0; i < mSize; ++i) {
+        float x = mData[i];
+        result->mData[i] = 0.5f * x * (1.0f + std::tanh(k * (x + c * x * x * x)));
+    }
+
+    // Forward-mode tangent
+    if (auto tangent = tangentData()) {
+        auto resultTangent = result->tangentBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            float x = mData[i];
+            float t = std::tanh(k * (x + c * x * x * x));
+            resultTangent[i] = tangent[i] * (0.5f * (1.0f + t) + 0.5f * x * (1.0f - t * t) * k * (1.0f + 3.0f * c * x * x));
+        }
+    }
+
+    return result;
+}
+
+Value *Value::sigmoid(Value *out) {
+    auto result = makeResult(out, mSize, {this});
+    result->setBackward([result, this]() {
+        auto resultGrad = result->gradBuffer();
+        auto grad = gradBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            grad[i] += resultGrad[i] * result->mData[i] * (1.0f - result->mData[i]);
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        auto resultGradTangent = result->gradTangentData();
+        auto tangent = tangentData();
+        if (resultGradTangent || tangent) {
+            auto gradTangent = gradTangentBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                float y = result->mData[i];
+                float first = y * (1.0f - y);
+                gradTangent[i] += (resultGradTangent ? resultGradTangent[i] * first : 0.0f) +
+                                  (tangent ? resultGrad[i] * first * (1.0f - 2.0f * y) * tangent[i] : 0.0f);
+            }
+        }
+    });
+
+    for (size_t i = 0; i < mSize; ++i) {
+        result->mData[i] = 1.0f / (1.0f + std::exp(-mData[i]));
+    }
+
+    // Forward-mode tangent
+    if (auto tangent = tangentData()) {
+        auto resultTangent = result->tangentBuffer();
+        for (size_t i = 0; i < mSize; ++i) {
+            resultTangent[i] = tangent[i] * result->mData[i] * (1.0f - result->mData[i]);
+        }
+    }
+
     return result;
 }
 
@@ -245,16 +615,233 @@ size_t Value::getSize() const {
 }
 
 std::unique_ptr<std::vector<float>> Value::getData() {
-    auto result = std::make_unique<std::vector<float>>();
-    for (size_t i = 0; i < mSize; ++i) {
-        result->push_back(mData[i]);
+    return std::make_unique<std::vector<float>>(mData, mData + mSize);
+}
+
+Value *Value::getGrad() {
+    auto result = new Value(mSize);
+    addGradTo(result->mData);
+    return result;
+}
+
+Span<float> Value::getDataSpan() {
+    return {mData, mSize};
+}
+
+Span<const float> Value::getDataSpan() const {
+    return {mData, mSize};
+}
+
+Span<float> Value::getGradSpan() {
+    return {gradBuffer(), mSize};
+}
+
+Span<const float> Value::getDenseGradSpan() const {
+    if (!hasDenseGrad()) {
+        return {};
     }
+    return {mStorage->grad.get() + mOffset, mSize};
+}
 
+std::vector<std::pair<size_t, float>> Value::getSparseGrad() const {
+    std::vector<std::pair<size_t, float>> result;
+    if (hasSparseGrad()) {
+        // Entries are indexed by storage; keep those inside this view
+        for (auto &entry: mStorage->sparseGrad) {
+            if (entry.first >= mOffset && entry.first < mOffset + mSize) {
+                result.emplace_back(entry.first - mOffset, entry.second);
+            }
+        }
+    }
     return result;
 }
 
-Value *Value::getGrad() {
-    return new Value(mSize, mGrad.get());
+bool Value::hasTangent() const {
+    return mStorage && mStorage->tangent != nullptr;
+}
+
+Span<float> Value::getTangentSpan() {
+    return {tangentBuffer(), mSize};
+}
+
+void Value::clearTangent() {
+    if (mStorage) {
+        mStorage->tangent.reset();
+    }
+}
+
+bool Value::hasGradTangent() const {
+    return mStorage && mStorage->gradTangent && mStorage->gradTangentGeneration == sGradGeneration;
+}
+
+Span<float> Value::getGradTangentSpan() {
+    return {gradTangentBuffer(), mSize};
+}
+
+const float *Value::gradTangentData() const {
+    return hasGradTangent() ? mStorage->gradTangent.get() + mOffset : nullptr;
+}
+
+float *Value::gradTangentBuffer() {
+    // Allocated and zeroed lazily per gradient generation, like the gradient itself
+    if (!mStorage) {
+        return nullptr;
+    }
+    if (!mStorage->gradTangent) {
+        mStorage->gradTangent = Allocator::allocate(mStorage->size);
+        mStorage->gradTangentGeneration = 0;
+    }
+    if (mStorage->gradTangentGeneration != sGradGeneration) {
+        std::fill(&mStorage->gradTangent[0], &mStorage->gradTangent[0] + mStorage->size, 0.0f);
+        mStorage->gradTangentGeneration = sGradGeneration;
+    }
+    return mStorage->gradTangent.get() + mOffset;
+}
+
+const float *Value::tangentData() const {
+    return mStorage && mStorage->tangent ? mStorage->tangent.get() + mOffset : nullptr;
+}
+
+float *Value::tangentBuffer() {
+    if (!mStorage) {
+        return nullptr;
+    }
+    if (!mStorage->tangent) {
+        mStorage->tangent = Allocator::allocate(mStorage->size);
+    }
+    return mStorage->tangent.get() + mOffset;
+}
+
+Value *Value::slice(size_t offset, size_t size) {
+    if (offset + size > mSize) {
+        throw std::out_of_range("slice out of range");
+    }
+    auto result = new Value(*this, offset, size);
+    result->setReferences({this});
+    return result;
+}
+
+Value *Value::outputSlice(size_t offset, size_t size) {
+    if (offset + size > mSize) {
+        throw std::out_of_range("slice out of range");
+    }
+    return new Value(*this, offset, size);
+}
+
+Value *Value::makeResult(Value *out, size_t size, std::initializer_list<Value *> refs) {
+    std::vector<Value *> references(refs);
+    return makeResult(out, size, references);
+}
+
+Value *Value::makeResult(Value *out, size_t size, std::vector<Value *> &refs) {
+    if (!out) {
+        return new Value(size, refs);
+    }
+    if (out->mSize != size) {
+        throw std::logic_error("size mismatch");
+    }
+    out->setReferences(refs);
+    // Clear any tangent left in the destination by an earlier pass
+    if (out->hasTangent()) {
+        std::fill(out->tangentBuffer(), out->tangentBuffer() + size, 0.0f);
+    }
+    return out;
+}
+
+void Value::setReferences(std::vector<Value *> refs) {
+    // Only nodes downstream of something trainable take part in backward(), and
+    // with gradients disabled nothing is recorded at all
+    mRequiresGrad = sGradEnabled && std::any_of(refs.begin(), refs.end(),
+                                                [](Value *ref) { return ref->mRequiresGrad; });
+    mReferences = mRequiresGrad ? std::move(refs) : std::vector<Value *>();
+}
+
+bool Value::getRequiresGrad() const {
+    return mRequiresGrad;
+}
+
+void Value::setRequiresGrad(bool requiresGrad) {
+    mRequiresGrad = requiresGrad;
+}
+
+bool Value::hasGrad() const {
+    return hasDenseGrad() || hasSparseGrad();
+}
+
+bool Value::hasDenseGrad() const {
+    return mStorage && mStorage->grad && mStorage->gradGeneration == sGradGeneration;
+}
+
+bool Value::hasSparseGrad() const {
+    return mStorage && mStorage->sparseGradGeneration == sGradGeneration && !mStorage->sparseGrad.empty();
+}
+
+float *Value::gradBuffer() {
+    // Allocate on first accumulation, and zero lazily if the buffer belongs to a cleared generation.
+    // Views share the gradient of their whole storage.
+    if (!mStorage) {
+        return nullptr;
+    }
+    if (!mStorage->grad) {
+        mStorage->grad = Allocator::allocate(mStorage->size);
+        mStorage->gradGeneration = 0;
+    }
+    if (mStorage->gradGeneration != sGradGeneration) {
+        std::fill(&mStorage->grad[0], &mStorage->grad[0] + mStorage->size, 0.0f);
+        mStorage->gradGeneration = sGradGeneration;
+    }
+    // Fold in any sparse contributions so the dense buffer is complete
+    if (hasSparseGrad()) {
+        for (auto &entry: mStorage->sparseGrad) {
+            mStorage->grad[entry.first] += entry.second;
+        }
+    }
+    mStorage->sparseGrad.clear();
+    return mStorage->grad.get() + mOffset;
+}
+
+void Value::accumulateSparseGrad(size_t index, float grad) {
+    if (mStorage->sparseGradGeneration != sGradGeneration) {
+        mStorage->sparseGrad.clear();
+        mStorage->sparseGradGeneration = sGradGeneration;
+    }
+    mStorage->sparseGrad.emplace_back(mOffset + index, grad);
+}
+
+void Value::addGradTo(float *out) const {
+    if (hasDenseGrad()) {
+        auto grad = mStorage->grad.get() + mOffset;
+        for (size_t i = 0; i < mSize; ++i) {
+            out[i] += grad[i];
+        }
+    }
+    if (hasSparseGrad()) {
+        for (auto &entry: mStorage->sparseGrad) {
+            if (entry.first >= mOffset && entry.first < mOffset + mSize) {
+                out[entry.first - mOffset] += entry.second;
+            }
+        }
+    }
+}
+
+void Value::step(float learningRate) {
+    markModified();
+    // Sparse-only gradients update just the entries they touch
+    if (!hasDenseGrad()) {
+        if (hasSparseGrad()) {
+            for (auto &entry: mStorage->sparseGrad) {
+                if (entry.first >= mOffset && entry.first < mOffset + mSize) {
+                    mStorage->data[entry.first] -= learningRate * entry.second;
+                }
+            }
+        }
+        return;
+    }
+
+    auto grad = gradBuffer();
+    for (size_t i = 0; i < mSize; ++i) {
+        mData[i] -= learningRate * grad[i];
+    }
 }
 
 
@@ -266,10 +853,17 @@ std::ostream &operator<<(std::ostream &os, const Value &obj) {
 }
 
 void Value::setBackward(std::function<void()> backward) {
-    mBackward = backward;
+    // A node outside any trainable graph never runs its backward, so don't keep the closure
+    if (mRequiresGrad) {
+        mBackward = backward;
+    }
 }
 
 void Value::backward() {
+    backward(nullptr);
+}
+
+void Value::backward(const std::function<void(Value *)> &onLeafReady) {
     struct Helper {
         static void sort(Value *value, std::unordered_set<Value *> &visited, std::vector<Value *> &result) {
             if (visited.find(value) != visited.end()) {
@@ -277,32 +871,69 @@ void Value::backward() {
             }
             visited.insert(value);
             for (auto &ref: value->mReferences) {
-                sort(ref, visited, result);
+                // Subgraphs without trainable leaves never receive gradients
+                if (ref->mRequiresGrad) {
+                    sort(ref, visited, result);
+                }
             }
             result.push_back(value);
         }
     };
 
+    auto grad = gradBuffer();
     for (size_t i = 0; i < mSize; ++i) {
-        mGrad[i] = 1.0f;
+        grad[i] = 1.0f;
+    }
+    if (hasGradTangent()) {
+        std::fill(gradTangentBuffer(), gradTangentBuffer() + mSize, 0.0f);
     }
 
     std::unordered_set<Value *> visited;
     std::vector<Value *> sorted;
     Helper::sort(this, visited, sorted);
 
+    // A leaf's gradient is final once every node consuming it has run
+    std::unordered_map<Value *, size_t> pending;
+    if (onLeafReady) {
+        for (auto value: sorted) {
+            for (auto &ref: value->mReferences) {
+                if (ref->mRequiresGrad) {
+                    ++pending[ref];
+                }
+            }
+        }
+    }
+
     for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
-        if ((*it)->mBackward) {
+        // A node no gradient flowed into has nothing to propagate
+        if ((*it)->mBackward && (*it)->hasGrad()) {
             (*it)->mBackward();
         }
+        if (onLeafReady) {
+            for (auto &ref: (*it)->mReferences) {
+                if (ref->mRequiresGrad && --pending[ref] == 0 && ref->mReferences.empty()) {
+                    onLeafReady(ref);
+                }
+            }
+        }
     }
 }
 
 Value *Value::sum() {
     auto result = new Value(1, {this});
     result->setBackward([result, this]() {
+        auto resultGrad = result->gradBuffer();
+        auto grad = gradBuffer();
         for (size_t i = 0; i < mSize; ++i) {
-            mGrad[i] += result->mGrad[0];
+            grad[i] += resultGrad[0];
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        if (auto resultGradTangent = result->gradTangentData()) {
+            auto gradTangent = gradTangentBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                gradTangent[i] += resultGradTangent[0];
+            }
         }
     });
 
@@ -312,6 +943,15 @@ Value *Value::sum() {
     }
     result->mData[0] = sum;
 
+    // Forward-mode tangent
+    if (auto tangent = tangentData()) {
+        float tangentSum = 0.0f;
+        for (size_t i = 0; i < mSize; ++i) {
+            tangentSum += tangent[i];
+        }
+        result->tangentBuffer()[0] = tangentSum;
+    }
+
     return result;
 }
 
@@ -320,79 +960,457 @@ Value *Value::dot(Value &other) {
     return result->sum();
 }
 
-float Value::at(size_t index) const {
-    return mData[index];
+Value *Value::stackedAffine(Value &weights, Value &bias, size_t groups, Value *out) {
+    if (groups == 0 || bias.mSize == 0 || bias.mSize % groups != 0 || weights.mSize % bias.mSize != 0) {
+        throw std::logic_error("size mismatch");
+    }
+    size_t nOut = bias.mSize / groups;
+    size_t nIn = weights.mSize / bias.mSize;
+    if (mSize != nIn && mSize != groups * nIn) {
+        throw std::logic_error("size mismatch");
+    }
+    // A shared input is read by every group from offset 0
+    size_t stride = mSize == nIn ? 0 : nIn;
+
+    auto result = makeResult(out, bias.mSize, {this, &weights, &bias});
+    result->setBackward([result, this, &weights, &bias, groups, nOut, nIn, stride]() {
+        auto resultGrad = result->gradBuffer();
+        auto grad = mRequiresGrad ? gradBuffer() : nullptr;
+        auto weightsGrad = weights.mRequiresGrad ? weights.gradBuffer() : nullptr;
+        auto biasGrad = bias.mRequiresGrad ? bias.gradBuffer() : nullptr;
+        for (size_t k = 0; k < groups; ++k) {
+            const float *x = mData + k * stride;
+            for (size_t j = 0; j < nOut; ++j) {
+                size_t row = k * nOut + j;
+                float g = resultGrad[row];
+                const float *w = weights.mData + row * nIn;
+                if (biasGrad) {
+                    biasGrad[row] += g;
+                }
+                if (weightsGrad) {
+                    for (size_t i = 0; i < nIn; ++i) {
+                        weightsGrad[row * nIn + i] += g * x[i];
+                    }
+                }
+                if (grad) {
+                    for (size_t i = 0; i < nIn; ++i) {
+                        grad[k * stride + i] += g * w[i];
+                    }
+                }
+            }
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        auto resultGradTangent = result->gradTangentData();
+        auto tangent = tangentData();
+        auto weightsTangent = weights.tangentData();
+        if (resultGradTangent || tangent || weightsTangent) {
+            auto gradTangent = mRequiresGrad ? gradTangentBuffer() : nullptr;
+            auto weightsGradTangent = weights.mRequiresGrad ? weights.gradTangentBuffer() : nullptr;
+            auto biasGradTangent = bias.mRequiresGrad ? bias.gradTangentBuffer() : nullptr;
+            for (size_t k = 0; k < groups; ++k) {
+                const float *x = mData + k * stride;
+                for (size_t j = 0; j < nOut; ++j) {
+                    size_t row = k * nOut + j;
+                    float g = resultGrad[row];
+                    float gt = resultGradTangent ? resultGradTangent[row] : 0.0f;
+                    const float *w = weights.mData + row * nIn;
+                    if (biasGradTangent) {
+                        biasGradTangent[row] += gt;
+                    }
+                    for (size_t i = 0; i < nIn; ++i) {
+                        if (weightsGradTangent) {
+                            weightsGradTangent[row * nIn + i] += gt * x[i] + (tangent ? g * tangent[k * stride + i] : 0.0f);
+                        }
+                        if (gradTangent) {
+                            gradTangent[k * stride + i] += gt * w[i] +
+                                                           (weightsTangent ? g * weightsTangent[row * nIn + i] : 0.0f);
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    for (size_t k = 0; k < groups; ++k) {
+        const float *x = mData + k * stride;
+        for (size_t j = 0; j < nOut; ++j) {
+            size_t row = k * nOut + j;
+            const float *w = weights.mData + row * nIn;
+            // Independent partial sums so the loop vectorises
+            float partial[8] = {};
+            size_t i = 0;
+            for (; i + 8 <= nIn; i += 8) {
+                for (size_t lane = 0; lane < 8; ++lane) {
+                    partial[lane] += w[i + lane] * x[i + lane];
+                }
+            }
+            float sum = bias.mData[row];
+            for (; i < nIn; ++i) {
+                sum += w[i] * x[i];
+            }
+            for (float value: partial) {
+                sum += value;
+            }
+            result->mData[row] = sum;
+        }
+    }
+
+    // Forward-mode tangent
+    if (hasTangent() || weights.hasTangent() || bias.hasTangent()) {
+        auto tangent = tangentData();
+        auto weightsTangent = weights.tangentData();
+        auto biasTangent = bias.tangentData();
+        auto resultTangent = result->tangentBuffer();
+        for (size_t k = 0; k < groups; ++k) {
+            const float *x = mData + k * stride;
+            for (size_t j = 0; j < nOut; ++j) {
+                size_t row = k * nOut + j;
+                const float *w = weights.mData + row * nIn;
+                float sum = biasTangent ? biasTangent[row] : 0.0f;
+                for (size_t i = 0; i < nIn; ++i) {
+                    sum += (weightsTangent ? weightsTangent[row * nIn + i] * x[i] : 0.0f) +
+                           (tangent ? w[i] * tangent[k * stride + i] : 0.0f);
+                }
+                resultTangent[row] = sum;
+            }
+        }
+    }
+
+    return result;
 }
 
-Value *Value::concat(std::initializer_list<Value *> values) {
-    size_t size = 0;
-    for (auto &value: values) {
-        size += value->getSize();
+Value *Value::mse(Value &target) {
+    return mse(target, 1);
+}
+
+Value *Value::mse(Value &target, size_t groups) {
+    if (groups == 0 || mSize % groups != 0) {
+        throw std::logic_error("size mismatch");
+    }
+    size_t n = mSize / groups;
+    if (target.mSize != mSize && target.mSize != n) {
+        throw std::logic_error("size mismatch");
     }
+    // A shared target is read by every group from offset 0
+    size_t targetStride = target.mSize == mSize ? n : 0;
+
+    // d/dx mean((x - t)^2) = 2 (x - t) / n, and the negation for the target
+    auto result = new Value(groups, {this, &target});
+    result->setBackward([result, this, &target, groups, n, targetStride]() {
+        auto resultGrad = result->gradBuffer();
+        auto grad = mRequiresGrad ? gradBuffer() : nullptr;
+        auto targetGrad = target.mRequiresGrad ? target.gradBuffer() : nullptr;
+        for (size_t k = 0; k < groups; ++k) {
+            float scale = 2.0f * resultGrad[k] / static_cast<float>(n);
+            for (size_t i = 0; i < n; ++i) {
+                float diff = mData[k * n + i] - target.mData[k * targetStride + i];
+                if (grad) {
+                    grad[k * n + i] += scale * diff;
+                }
+                if (targetGrad) {
+                    targetGrad[k * targetStride + i] -= scale * diff;
+                }
+            }
+        }
 
-    auto result = new Value(size, values);
-    result->setBackward([result, values]() {
-        size_t offset = 0;
-        for (auto &value: values) {
-            for (size_t i = 0; i < value->getSize(); ++i) {
-                value->mGrad[i] += result->mGrad[offset + i];
+        // Forward-over-reverse: tangent of the gradient
+        auto resultGradTangent = result->gradTangentData();
+        auto tangent = tangentData();
+        auto targetTangent = target.tangentData();
+        if (resultGradTangent || tangent || targetTangent) {
+            auto gradTangent = mRequiresGrad ? gradTangentBuffer() : nullptr;
+            auto targetGradTangent = target.mRequiresGrad ? target.gradTangentBuffer() : nullptr;
+            for (size_t k = 0; k < groups; ++k) {
+                float scale = 2.0f * resultGrad[k] / static_cast<float>(n);
+                float tangentScale = resultGradTangent ? 2.0f * resultGradTangent[k] / static_cast<float>(n) : 0.0f;
+                for (size_t i = 0; i < n; ++i) {
+                    size_t t = k * targetStride + i;
+                    float direction = (tangent ? tangent[k * n + i] : 0.0f) - (targetTangent ? targetTangent[t] : 0.0f);
+                    float contribution = tangentScale * (mData[k * n + i] - target.mData[t]) + scale * direction;
+                    if (gradTangent) {
+                        gradTangent[k * n + i] += contribution;
+                    }
+                    if (targetGradTangent) {
+                        targetGradTangent[t] -= contribution;
+                    }
+                }
             }
-            offset += value->getSize();
         }
     });
 
-    size_t offset = 0;
-    for (auto &value: values) {
-        for (size_t i = 0; i < value->getSize(); ++i) {
-            result->mData[offset + i] = value->mData[i];
+    for (size_t k = 0; k < groups; ++k) {
+        float sum = 0.0f;
+        for (size_t i = 0; i < n; ++i) {
+            float diff = mData[k * n + i] - target.mData[k * targetStride + i];
+            sum += diff * diff;
+        }
+        result->mData[k] = sum / static_cast<float>(n);
+    }
+
+    // Forward-mode tangent
+    if (hasTangent() || target.hasTangent()) {
+        auto tangent = tangentData();
+        auto targetTangent = target.tangentData();
+        auto resultTangent = result->tangentBuffer();
+        for (size_t k = 0; k < groups; ++k) {
+            float tangentSum = 0.0f;
+            for (size_t i = 0; i < n; ++i) {
+                size_t t = k * targetStride + i;
+                float direction = (tangent ? tangent[k * n + i] : 0.0f) - (targetTangent ? targetTangent[t] : 0.0f);
+                tangentSum += (mData[k * n + i] - target.mData[t]) * direction;
+            }
+            resultTangent[k] = 2.0f * tangentSum / static_cast<float>(n);
         }
-        offset += value->getSize();
     }
 
     return result;
 }
 
+Value *Value::softmaxCrossEntropy(Value &target) {
+    if (mSize != target.mSize) {
+        throw std::logic_error("size mismatch");
+    }
+
+    // Log-softmax with the max subtracted for stability, kept for the backward pass
+    auto logSoftmax = std::make_shared<std::vector<float>>(mSize);
+    float max = *std::max_element(mData, mData + mSize);
+    float total = 0.0f;
+    for (size_t i = 0; i < mSize; ++i) {
+        total += std::exp(mData[i] - max);
+    }
+    float logTotal = max + std::log(total);
+    for (size_t i = 0; i < mSize; ++i) {
+        (*logSoftmax)[i] = mData[i] - logTotal;
+    }
+
+    // d/dx -sum(t log softmax(x)) = softmax(x) sum(t) - t, and -log softmax(x) for the target
+    auto result = new Value(1, {this, &target});
+    result->setBackward([result, this, &target, logSoftmax]() {
+        auto resultGrad = result->gradBuffer();
+        if (mRequiresGrad) {
+            float targetSum = 0.0f;
+            for (size_t i = 0; i < mSize; ++i) {
+                targetSum += target.mData[i];
+            }
+            auto grad = gradBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                grad[i] += resultGrad[0] * (std::exp((*logSoftmax)[i]) * targetSum - target.mData[i]);
+            }
+        }
+        if (target.mRequiresGrad) {
+            auto targetGrad = target.gradBuffer();
+            for (size_t i = 0; i < mSize; ++i) {
+                targetGrad[i] -= resultGrad[0] * (*logSoftmax)[i];
+            }
+        }
+
+        // Forward-over-reverse: tangent of the gradient. The tangent of log softmax(x)
+        // is dx - sum(softmax(x) dx).
+        auto resultGradTangent = result->gradTangentData();
+        auto tangent = tangentData();
+        auto targetTangent = target.tangentData();
+        if (resultGradTangent || tangent || targetTangent) {
+            float gradTangentScale = resultGradTangent ? resultGradTangent[0] : 0.0f;
+            float targetSum = 0.0f;
+            float targetTangentSum = 0.0f;
+            float expectedTangent = 0.0f;
+            for (size_t i = 0; i < mSize; ++i) {
+                targetSum += target.mData[i];
+                targetTangentSum += targetTangent ? targetTangent[i] : 0.0f;
+                expectedTangent += tangent ? std::exp((*logSoftmax)[i]) * tangent[i] : 0.0f;
+            }
+            auto gradTangent = mRequiresGrad ? gradTangentBuffer() : nullptr;
+            auto targetGradTangent = target.mRequiresGrad ? target.gradTangentBuffer() : nullptr;
+            for (size_t i = 0; i < mSize; ++i) {
+                float probability = std::exp((*logSoftmax)[i]);
+                float logSoftmaxTangent = (tangent ? tangent[i] : 0.0f) - expectedTangent;
+                if (gradTangent) {
+                    gradTangent[i] +=
+                            gradTangentScale * (probability * targetSum - target.mData[i]) +
+                            resultGrad[0] * (probability * logSoftmaxTangent * targetSum + probability * targetTangentSum -
+                                             (targetTangent ? targetTangent[i] : 0.0f));
+                }
+                if (targetGradTangent) {
+                    targetGradTangent[i] -=
+                            gradTangentScale * (*logSoftmax)[i] + resultGrad[0] * logSoftmaxTangent;
+                }
+            }
+        }
+    });
+
+    float loss = 0.0f;
+    for (size_t i = 0; i < mSize; ++i) {
+        loss -= target.mData[i] * (*logSoftmax)[i];
+    }
+    result->mData[0] = loss;
+
+    // Forward-mode tangent
+    if (hasTangent() || target.hasTangent()) {
+        auto tangent = tangentData();
+        auto targetTangent = target.tangentData();
+        float targetSum = 0.0f;
+        for (size_t i = 0; i < mSize; ++i) {
+            targetSum += target.mData[i];
+        }
+        float tangentSum = 0.0f;
+        for (size_t i = 0; i < mSize; ++i) {
+            if (tangent) {
+                tangentSum += (std::exp((*logSoftmax)[i]) * targetSum - target.mData[i]) * tangent[i];
+            }
+            if (targetTangent) {
+                tangentSum -= (*logSoftmax)[i] * targetTangent[i];
+            }
+        }
+        result->tangentBuffer()[0] = tangentSum;
+    }
+
+    return result;
+}
+
+Value *Value::dot(SparseValue &other) {
+    if (mSize != other.getSize()) {
+        throw std::logic_error("size mismatch");
+    }
+
+    // Only the nonzero columns are read forward and receive gradient backward
+    auto &indices = other.getIndices();
+    auto &values = other.getValues();
+    auto result = new Value(1, {this});
+    result->setBackward([result, this, &indices, &values]() {
+        auto resultGrad = result->gradBuffer();
+        for (size_t k = 0; k < indices.size(); ++k) {
+            accumulateSparseGrad(indices[k], resultGrad[0] * values[k]);
+        }
+
+        // Forward-over-reverse: tangent of the gradient
+        if (auto resultGradTangent = result->gradTangentData()) {
+            auto gradTangent = gradTangentBuffer();
+            for (size_t k = 0; k < indices.size(); ++k) {
+                gradTangent[indices[k]] += resultGradTangent[0] * values[k];
+            }
+        }
+    });
+
+    float sum = 0.0f;
+    for (size_t k = 0; k < indices.size(); ++k) {
+        sum += mData[indices[k]] * values[k];
+    }
+    result->mData[0] = sum;
+
+    // Forward-mode tangent
+    if (auto tangent = tangentData()) {
+        float tangentSum = 0.0f;
+        for (size_t k = 0; k < indices.size(); ++k) {
+            tangentSum += tangent[indices[k]] * values[k];
+        }
+        result->tangentBuffer()[0] = tangentSum;
+    }
+
+    return result;
+}
+
+float Value::at(size_t index) const {
+    return mData[index];
+}
+
+Value *Value::concat(std::initializer_list<Value *> values) {
+    std::vector<Value *> refs(values);
+    return concat(refs);
+}
+
 Value *Value::concat(std::vector<Value *> &values) {
     size_t size = 0;
     for (auto &value: values) {
         size += value->getSize();
     }
 
+    // Adjacent ranges of one buffer, e.g. the outputs of a Layer, are joined without copying.
+    // Their gradients already share storage, so no backward function is needed.
+    bool contiguous = !values.empty();
+    for (size_t i = 1; contiguous && i < values.size(); ++i) {
+        contiguous = values[i]->mStorage == values[0]->mStorage &&
+                     values[i]->mOffset == values[i - 1]->mOffset + values[i - 1]->mSize;
+    }
+    if (contiguous) {
+        auto result = new Value(*values[0], 0, size);
+        result->setReferences(values);
+        return result;
+    }
+
     auto result = new Value(size, values);
     result->setBackward([result, values]() {
+        auto resultGrad = result->gradBuffer();
         size_t offset = 0;
         for (auto &value: values) {
-            for (size_t i = 0; i < value->getSize(); ++i) {
-                value->mGrad[i] += result->mGrad[offset + i];
+            if (value->mRequiresGrad) {
+                auto grad = value->gradBuffer();
+                for (size_t i = 0; i < value->getSize(); ++i) {
+                    grad[i] += resultGrad[offset + i];
+                }
             }
             offset += value->getSize();
         }
+
+        // Forward-over-reverse: tangent of the gradient
+        if (auto resultGradTangent = result->gradTangentData()) {
+            offset = 0;
+            for (auto &value: values) {
+                if (value->mRequiresGrad) {
+                    auto gradTangent = value->gradTangentBuffer();
+                    for (size_t i = 0; i < value->getSize(); ++i) {
+                        gradTangent[i] += resultGradTangent[offset + i];
+                    }
+                }
+                offset += value->getSize();
+            }
+        }
     });
 
     size_t offset = 0;
     for (auto &value: values) {
-        for (size_t i = 0; i < value->getSize(); ++i) {
-            result->mData[offset + i] = value->mData[i];
-        }
+        std::copy(value->mData, value->mData + value->mSize, result->mData + offset);
         offset += value->getSize();
     }
 
+
+    // Forward-mode tangent
+    if (std::any_of(values.begin(), values.end(), [](Value *value) { return value->hasTangent(); })) {
+        auto resultTangent = result->tangentBuffer();
+        offset = 0;
+        for (auto &value: values) {
+            if (auto tangent = value->tangentData()) {
+                std::copy(tangent, tangent + value->mSize, resultTangent + offset);
+            }
+            offset += value->getSize();
+        }
+    }
     return result;
 }
 
 void Value::clearGrad() {
-    for (size_t i = 0; i < mSize; ++i) {
-        mGrad[i] = 0.0f;
+    // Generation 0 never matches, so the buffer is treated as zero until reused
+    if (!mStorage) {
+        return;
     }
+    mStorage->gradGeneration = 0;
+    mStorage->sparseGradGeneration = 0;
+    mStorage->gradTangentGeneration = 0;
+}
+
+void Value::clearGrads() {
+    ++sGradGeneration;
 }
 
 void Value::operator+=(Value &other) {
+    markModified();
     for (size_t i = 0; i < mSize; ++i) {
         mData[i] += other.mData[i];
     }
 }
 
 void Value::operator-=(Value &other) {
+    markModified();
     for (size_t i = 0; i < mSize; ++i) {
         mData[i] -= other.mData[i];
     }
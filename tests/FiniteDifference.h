@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include "Curvature.h"
+#include "Random.h"
+
+// Central differences of the gradient along v, for comparison with H v
+inline std::vector<float> finiteDifference(const Curvature::Parameters &parameters,
+                                           const Curvature::Objective &objective, const std::vector<float> &v,
+                                           float epsilon) {
+    auto start = Curvature::getData(parameters);
+    std::vector<float> plus(start), minus(start), gradPlus, gradMinus;
+    for (size_t i = 0; i < start.size(); ++i) {
+        plus[i] += epsilon * v[i];
+        minus[i] -= epsilon * v[i];
+    }
+    Curvature::setData(parameters, plus);
+    Curvature::gradient(parameters, objective, gradPlus);
+    Curvature::setData(parameters, minus);
+    Curvature::gradient(parameters, objective, gradMinus);
+    Curvature::setData(parameters, start);
+
+    std::vector<float> result(start.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+        result[i] = (gradPlus[i] - gradMinus[i]) / (2.0f * epsilon);
+    }
+    return result;
+}
+
+inline std::vector<float> randomDirection(size_t size) {
+    std::vector<float> v(size);
+    Random::uniform(Span<float>(v.data(), v.size()), -1.0f, 1.0f);
+    return v;
+}
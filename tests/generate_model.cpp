@@ -0,0 +1,25 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "MultiLayerPerceptron.h"
+#include "Random.h"
+
+// Writes the headers compiled into the code generation test; the test rebuilds
+// the same networks from the same seed and compares against them.
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <output directory>" << std::endl;
+        return 1;
+    }
+
+    Random::seed(1234);
+    MultiLayerPerceptron mlp(2, {20, 20, 10, 1});
+    MultiLayerPerceptron mixed(3, {8, 8, 2}, {Activation::ReLU, Activation::GELU, Activation::Sigmoid});
+
+    std::string directory(argv[1]);
+    std::ofstream mlpHeader(directory + "/GeneratedMlp.h");
+    mlp.generateHeader(mlpHeader, "generatedMlp");
+    std::ofstream mixedHeader(directory + "/GeneratedMixed.h");
+    mixed.generateHeader(mixedHeader, "generatedMixed");
+    return mlpHeader && mixedHeader ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "Allocator.h"
+#include "Random.h"
+#include "ThreadAffinity.h"
+#include "Value.h"
+
+TEST(TestAllocator, TestSmallBuffersAreZeroed) {
+    auto buffer = Allocator::allocate(100);
+    for (size_t i = 0; i < 100; ++i) {
+        ASSERT_EQ(0.0f, buffer[i]);
+    }
+    ASSERT_FALSE(buffer.get_deleter().mapped);
+}
+
+TEST(TestAllocator, TestLargeBuffersAreMapped) {
+    for (auto hugePages: {Allocator::HugePages::Off, Allocator::HugePages::Transparent, Allocator::HugePages::Explicit}) {
+        Allocator::setHugePages(hugePages);
+        Allocator::setPlacement(Allocator::Placement::Interleave);
+        auto buffer = Allocator::allocate(1 << 20);
+        ASSERT_TRUE(buffer.get_deleter().mapped);
+        ASSERT_EQ(0u, buffer.get_deleter().bytes % (2 * 1024 * 1024));
+        ASSERT_EQ(0.0f, buffer[0]);
+        ASSERT_EQ(0.0f, buffer[(1 << 20) - 1]);
+        buffer[(1 << 20) - 1] = 1.0f;
+    }
+    Allocator::setHugePages(Allocator::HugePages::Transparent);
+    Allocator::setPlacement(Allocator::Placement::Local);
+}
+
+TEST(TestAllocator, TestNodeOutOfRange) {
+    ASSERT_THROW(Allocator::setPlacement(Allocator::Placement::Node, -1), std::out_of_range);
+    ASSERT_THROW(Allocator::setPlacement(Allocator::Placement::Node, 256), std::out_of_range);
+
+    Allocator::setPlacement(Allocator::Placement::Node, 255);
+    auto buffer = Allocator::allocate(1 << 20);
+    ASSERT_EQ(0.0f, buffer[0]);
+    Allocator::setPlacement(Allocator::Placement::Local);
+}
+
+TEST(TestAllocator, TestMappedValueGradients) {
+    Allocator::setMappingThreshold(1024);
+    std::vector<float> values(1000, 2.0f);
+    Value a(values.size(), values.data());
+    auto s = a.sum();
+    s->backward();
+    ASSERT_EQ(1.0f, a.getGradSpan()[999]);
+    Allocator::setMappingThreshold(2 * 1024 * 1024);
+}
+
+TEST(TestThreadAffinity, TestParseCpus) {
+    ASSERT_EQ(std::vector<size_t>({0, 1, 2, 3, 8, 10}), ThreadAffinity::parseCpus("0-3,8,,10"));
+    ASSERT_TRUE(ThreadAffinity::parseCpus("").empty());
+}
+
+TEST(TestThreadAffinity, TestPinnedFillMatchesUnpinned) {
+    std::vector<float> a(1 << 17), b(1 << 17);
+    Random::uniform(Span<float>(a.data(), a.size()), -1.0f, 1.0f, 3, 0, 1);
+    ThreadAffinity::setCpus({0});
+    Random::uniform(Span<float>(b.data(), b.size()), -1.0f, 1.0f, 3, 0, 2);
+    ThreadAffinity::setCpus({});
+    ASSERT_EQ(a, b);
+}
+
+TEST(TestThreadAffinity, TestSetCpusWhilePinning) {
+    // Pools keep pinning their workers while the list is being replaced
+    std::atomic<bool> done{false};
+    std::thread configurer([&done]() {
+        for (size_t i = 0; !done.load(); ++i) {
+            ThreadAffinity::setCpus(i % 2 ? std::vector<size_t>{0} : std::vector<size_t>{0, 0, 0});
+        }
+    });
+    std::vector<float> a(1 << 16), b(1 << 16);
+    Random::uniform(Span<float>(a.data(), a.size()), -1.0f, 1.0f, 5, 0, 1);
+    for (size_t round = 0; round < 20; ++round) {
+        Random::uniform(Span<float>(b.data(), b.size()), -1.0f, 1.0f, 5, 0, 4);
+        EXPECT_EQ(a, b);
+    }
+    done = true;
+    configurer.join();
+    ThreadAffinity::setCpus({});
+}
@@ -0,0 +1,175 @@
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include "BatchScorer.h"
+#include "MultiLayerPerceptron.h"
+#include "Random.h"
+
+namespace {
+    std::vector<float> reference(MultiLayerPerceptron &mlp, const std::vector<float> &row) {
+        Value input(row.size(), const_cast<float *>(row.data()));
+        Value::NoGrad noGrad;
+        auto output = mlp(input);
+        auto data = output->getDataSpan();
+        return {data.begin(), data.end()};
+    }
+
+    std::vector<std::vector<float>> randomRows(size_t rows, size_t nIn) {
+        std::vector<std::vector<float>> result(rows, std::vector<float>(nIn));
+        for (auto &row: result) {
+            Random::uniform(Span<float>(row.data(), row.size()), -2.0f, 2.0f);
+        }
+        return result;
+    }
+}
+
+TEST(TestBatchScorer, TestSaveAndLoad) {
+    Random::seed(1);
+    MultiLayerPerceptron mlp(3, {5, 4, 2}, {Activation::ReLU, Activation::GELU, Activation::Sigmoid});
+    std::stringstream stream;
+    mlp.save(stream);
+
+    auto loaded = MultiLayerPerceptron::load(stream);
+    ASSERT_EQ(3u, loaded.getLayers().size());
+    ASSERT_EQ(Activation::GELU, loaded.getLayers()[1]->getActivation());
+    std::vector<float> row{0.5f, -1.0f, 0.25f};
+    ASSERT_EQ(reference(mlp, row), reference(loaded, row));
+
+    std::string saved = stream.str();
+    std::stringstream shortened(saved.substr(0, saved.size() - 4));
+    ASSERT_THROW(MultiLayerPerceptron::load(shortened), std::runtime_error);
+    std::stringstream garbage("not a model at all");
+    ASSERT_THROW(MultiLayerPerceptron::load(garbage), std::runtime_error);
+}
+
+TEST(TestBatchScorer, TestPredictMatchesModel) {
+    Random::seed(2);
+    for (auto activation: {Activation::Tanh, Activation::ReLU, Activation::GELU, Activation::Sigmoid}) {
+        MultiLayerPerceptron mlp(11, {9, 3}, {activation, activation});
+        BatchScorer scorer(mlp);
+        auto rows = randomRows(5, 11);
+        std::vector<float> input;
+        for (auto &row: rows) {
+            input.insert(input.end(), row.begin(), row.end());
+        }
+        std::vector<float> output(5 * 3), scratch;
+        scorer.predict(input.data(), 5, output.data(), scratch);
+        for (size_t r = 0; r < rows.size(); ++r) {
+            auto expected = reference(mlp, rows[r]);
+            for (size_t j = 0; j < 3; ++j) {
+                ASSERT_NEAR(expected[j], output[r * 3 + j], 1e-5);
+            }
+        }
+    }
+}
+
+TEST(TestBatchScorer, TestScoreCsv) {
+    Random::seed(3);
+    MultiLayerPerceptron mlp(2, {4, 2});
+    BatchScorer scorer(mlp);
+    auto rows = randomRows(103, 2);
+
+    // Header, CRLF line endings and blank lines are all accepted
+    std::string path = "test_batch_scorer.csv";
+    {
+        std::ofstream file(path);
+        file << "a,b\r\n";
+        for (size_t r = 0; r < rows.size(); ++r) {
+            file << rows[r][0] << ", " << rows[r][1] << (r % 2 ? "\r\n" : "\n");
+            if (r == 50) {
+                file << "\n";
+            }
+        }
+    }
+
+    for (size_t threads: {1, 3}) {
+        BatchScorer::Options options;
+        options.threads = threads;
+        options.batchRows = 8;
+        options.inFlight = 2;
+        std::stringstream output;
+        auto report = scorer.score(path, BatchScorer::Format::Csv, output, options);
+        ASSERT_EQ(rows.size(), report.rows);
+        ASSERT_GE(report.max, report.p50);
+
+        // Predictions come back in input order, one line per row
+        std::string line;
+        for (auto &row: rows) {
+            ASSERT_TRUE(std::getline(output, line));
+            auto expected = reference(mlp, row);
+            float first = 0.0f, second = 0.0f;
+            ASSERT_EQ(2, std::sscanf(line.c_str(), "%f,%f", &first, &second));
+            ASSERT_NEAR(expected[0], first, 1e-5);
+            ASSERT_NEAR(expected[1], second, 1e-5);
+        }
+        ASSERT_FALSE(std::getline(output, line));
+    }
+    std::remove(path.c_str());
+}
+
+TEST(TestBatchScorer, TestScoreBinary) {
+    Random::seed(4);
+    MultiLayerPerceptron mlp(3, {2});
+    BatchScorer scorer(mlp);
+    auto rows = randomRows(1000, 3);
+
+    std::string path = "test_batch_scorer.bin";
+    {
+        std::ofstream file(path, std::ios::binary);
+        for (auto &row: rows) {
+            file.write(reinterpret_cast<const char *>(row.data()), row.size() * sizeof(float));
+        }
+    }
+
+    BatchScorer::Options options;
+    options.threads = 2;
+    options.batchRows = 64;
+    options.outputFormat = BatchScorer::Format::Binary;
+    std::stringstream output;
+    auto report = scorer.score(path, BatchScorer::formatOf(path), output, options);
+    ASSERT_EQ(1000u, report.rows);
+    ASSERT_EQ(16u, report.batches);
+
+    auto bytes = output.str();
+    ASSERT_EQ(1000 * 2 * sizeof(float), bytes.size());
+    auto predictions = reinterpret_cast<const float *>(bytes.data());
+    for (size_t r = 0; r < rows.size(); r += 97) {
+        auto expected = reference(mlp, rows[r]);
+        ASSERT_NEAR(expected[0], predictions[r * 2], 1e-5);
+        ASSERT_NEAR(expected[1], predictions[r * 2 + 1], 1e-5);
+    }
+
+    // A partial trailing row is rejected
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::app);
+        file.write("xx", 2);
+    }
+    ASSERT_THROW(scorer.score(path, BatchScorer::Format::Binary, output, options), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(TestBatchScorer, TestMalformedCsv) {
+    MultiLayerPerceptron mlp(2, {1});
+    BatchScorer scorer(mlp);
+    std::string path = "test_batch_scorer_bad.csv";
+    {
+        std::ofstream file(path);
+        for (size_t r = 0; r < 40; ++r) {
+            file << (r == 30 ? "1.0,oops" : "1.0,2.0") << "\n";
+        }
+    }
+    BatchScorer::Options options;
+    options.threads = 2;
+    options.batchRows = 4;
+    std::stringstream output;
+    try {
+        scorer.score(path, BatchScorer::Format::Csv, output, options);
+        FAIL();
+    } catch (const std::runtime_error &e) {
+        ASSERT_EQ(std::string("malformed CSV at line 31"), e.what());
+    }
+    std::remove(path.c_str());
+}
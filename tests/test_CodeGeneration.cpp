@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+#include "GeneratedMixed.h"
+#include "GeneratedMlp.h"
+#include "MultiLayerPerceptron.h"
+#include "Random.h"
+
+TEST(TestCodeGeneration, TestMatchesRuntimeModel) {
+    // Same seed and construction order as generate_model.cpp
+    Random::seed(1234);
+    MultiLayerPerceptron mlp(2, {20, 20, 10, 1});
+    MultiLayerPerceptron mixed(3, {8, 8, 2}, {Activation::ReLU, Activation::GELU, Activation::Sigmoid});
+
+    static_assert(generatedMlp_inputs == 2 && generatedMlp_outputs == 1);
+    for (float x : {-1.0f, -0.3f, 0.0f, 0.4f, 2.0f}) {
+        float input[2] = {x, 0.5f - x};
+        float output[1];
+        generatedMlp(input, output);
+
+        Value value {input[0], input[1]};
+        EXPECT_NEAR(mlp(value)->at(0), output[0], 1e-5);
+
+        float mixedInput[3] = {x, -x, 2.0f * x};
+        float mixedOutput[2];
+        generatedMixed(mixedInput, mixedOutput);
+
+        Value mixedValue {mixedInput[0], mixedInput[1], mixedInput[2]};
+        auto expected = mixed(mixedValue);
+        EXPECT_NEAR(expected->at(0), mixedOutput[0], 1e-5);
+        EXPECT_NEAR(expected->at(1), mixedOutput[1], 1e-5);
+    }
+}
@@ -0,0 +1,194 @@
+#include <cmath>
+#include <gtest/gtest.h>
+#include "Curvature.h"
+#include "Expression.h"
+#include "FiniteDifference.h"
+#include "LBFGS.h"
+#include "MultiLayerPerceptron.h"
+#include "NewtonCG.h"
+#include "Random.h"
+#include "SparseValue.h"
+
+TEST(TestCurvature, TestExactHessianVectorProduct) {
+    // f(x) = sum(x^3) has H = diag(6 x)
+    auto x = std::make_shared<Value>(Value{1.0f, -2.0f, 0.5f});
+    Curvature::Parameters parameters{x};
+    auto product = Curvature::hessianVectorProduct(parameters, [&x]() { return x->pow(3.0f)->sum(); },
+                                                   {1.0f, 2.0f, -1.0f});
+    ASSERT_NEAR(6.0f, product[0], 1e-5);
+    ASSERT_NEAR(-24.0f, product[1], 1e-5);
+    ASSERT_NEAR(-3.0f, product[2], 1e-5);
+
+    // Tangents are removed again, so later passes are plain first order
+    ASSERT_FALSE(x->hasTangent());
+}
+
+TEST(TestCurvature, TestMatchesFiniteDifferences) {
+    Random::seed(7);
+    Value input{0.5f, -0.3f, 0.8f};
+    input.setRequiresGrad(false);
+    Value target{0.2f, -0.4f};
+    target.setRequiresGrad(false);
+    Value classes{0.0f, 1.0f};
+    classes.setRequiresGrad(false);
+
+    for (auto activation: {Activation::Tanh, Activation::GELU, Activation::Sigmoid}) {
+        MultiLayerPerceptron mlp(3, {4, 2}, {activation, activation});
+        auto parameters = mlp.getParameters();
+        auto v = randomDirection(Curvature::getSize(*parameters));
+
+        Curvature::Objective mse = [&]() { return mlp(input)->mse(target); };
+        Curvature::Objective crossEntropy = [&]() { return mlp(input)->softmaxCrossEntropy(classes); };
+        for (auto &objective: {mse, crossEntropy}) {
+            auto product = mlp.hessianVectorProduct(objective, v);
+            auto expected = finiteDifference(*parameters, objective, v, 1e-2f);
+            for (size_t i = 0; i < product.size(); ++i) {
+                ASSERT_NEAR(expected[i], product[i], 2e-3f + 2e-2f * std::fabs(expected[i]));
+            }
+        }
+    }
+}
+
+TEST(TestCurvature, TestSymmetric) {
+    Random::seed(11);
+    MultiLayerPerceptron mlp(2, {3, 1});
+    Value input{0.3f, -0.7f};
+    Value target{0.5f};
+    auto parameters = mlp.getParameters();
+    Curvature::Objective objective = [&]() { return mlp(input)->mse(target); };
+
+    auto v = randomDirection(Curvature::getSize(*parameters));
+    auto w = randomDirection(Curvature::getSize(*parameters));
+    auto hv = Curvature::hessianVectorProduct(*parameters, objective, v);
+    auto hw = Curvature::hessianVectorProduct(*parameters, objective, w);
+
+    float wHv = 0.0f, vHw = 0.0f;
+    for (size_t i = 0; i < v.size(); ++i) {
+        wHv += w[i] * hv[i];
+        vHw += v[i] * hw[i];
+    }
+    ASSERT_NEAR(wHv, vHw, 1e-4f);
+}
+
+TEST(TestCurvature, TestSparseAndConcat) {
+    auto w = std::make_shared<Value>(Value{0.5f, -1.0f, 2.0f, 0.25f});
+    Curvature::Parameters parameters{w};
+    SparseValue x(4, {0, 2}, {1.0f, -2.0f});
+    Value other{0.3f};
+    other.setRequiresGrad(false);
+
+    // (w . x)^2 + sum(tanh(concat(w, other))), through the sparse and copying concat paths
+    Curvature::Objective objective = [&]() {
+        auto dot = w->dot(x);
+        return *(*dot * *dot) + *Value::concat({w.get(), &other})->tanh()->sum();
+    };
+    auto v = std::vector<float>{1.0f, 0.5f, -1.0f, 2.0f};
+    auto product = Curvature::hessianVectorProduct(parameters, objective, v);
+    auto expected = finiteDifference(parameters, objective, v, 1e-2f);
+    for (size_t i = 0; i < product.size(); ++i) {
+        ASSERT_NEAR(expected[i], product[i], 2e-3f + 2e-2f * std::fabs(expected[i]));
+    }
+}
+
+TEST(TestCurvature, TestThroughExpression) {
+    auto a = std::make_shared<Value>(Value{0.5f, -1.0f, 2.0f});
+    auto b = std::make_shared<Value>(Value{1.5f, 0.25f, -0.5f});
+    Curvature::Parameters parameters{a, b};
+    auto v = std::vector<float>{1.0f, -0.5f, 0.25f, 2.0f, 1.0f, -1.0f};
+
+    Curvature::Objective chained = [&]() {
+        return (*(*a->tanh() * *b) / *(*(*b * *b) + 1.0f))->exp()->sum();
+    };
+    Curvature::Objective fused = [&]() {
+        auto la = Expression::leaf(*a);
+        auto lb = Expression::leaf(*b);
+        return Expression::evaluate(Expression::exp(Expression::tanh(la) * lb / (lb * lb + 1.0f)))->sum();
+    };
+    auto expected = Curvature::hessianVectorProduct(parameters, chained, v);
+    auto product = Curvature::hessianVectorProduct(parameters, fused, v);
+    for (size_t i = 0; i < product.size(); ++i) {
+        ASSERT_NEAR(expected[i], product[i], 1e-4f);
+    }
+}
+
+TEST(TestCurvature, TestOptimizersBeatGradientDescent) {
+    std::vector<std::vector<float>> xs{{0.5f, 0.1f}, {0.7f, 1.0f}, {0.1f, -0.2f}, {-0.1f, 1.0f}, {-0.5f, -0.1f}};
+    Value target{1.0f, 0.0f, 1.0f, 0.0f, 0.5f};
+    target.setRequiresGrad(false);
+    std::vector<Value> inputs;
+    for (auto &x: xs) {
+        inputs.emplace_back(x.size(), x.data());
+        inputs.back().setRequiresGrad(false);
+    }
+
+    auto train = [&](int optimizer) {
+        Random::seed(3);
+        MultiLayerPerceptron mlp(2, {8, 1});
+        Curvature::Objective objective = [&]() {
+            std::vector<Value *> outputs;
+            for (auto &input: inputs) {
+                outputs.push_back(mlp(input));
+            }
+            return Value::concat(outputs)->mse(target);
+        };
+        auto parameters = mlp.getParameters();
+        LBFGS lbfgs(parameters);
+        NewtonCG newton(parameters);
+        std::vector<float> gradient;
+        for (size_t step = 0; step < 30; ++step) {
+            if (optimizer == 0) {
+                Curvature::gradient(*parameters, objective, gradient);
+                for (auto &parameter: *parameters) {
+                    parameter->step(0.1f);
+                }
+            } else if (optimizer == 1) {
+                lbfgs.step(objective);
+            } else {
+                newton.step(objective);
+            }
+        }
+        return Curvature::loss(objective);
+    };
+
+    float descent = train(0);
+    ASSERT_LT(train(1), descent);
+    ASSERT_LT(train(2), descent);
+}
+
+TEST(TestCurvature, TestFailedLineSearchStaysPut) {
+    // Every evaluation costs more than the last, so no trial step can pass the Armijo test
+    auto x = std::make_shared<Value>(Value{1.0f, -2.0f});
+    auto parameters = std::make_shared<Curvature::Parameters>(Curvature::Parameters{x});
+    float penalty = 0.0f;
+    Curvature::Objective objective = [&]() {
+        penalty += 100.0f;
+        return *x->dot(*x) + penalty;
+    };
+
+    LBFGS lbfgs(parameters);
+    auto start = Curvature::getData(*parameters);
+    for (size_t step = 0; step < 3; ++step) {
+        lbfgs.step(objective);
+        ASSERT_EQ(start, Curvature::getData(*parameters));
+    }
+}
+
+TEST(TestCurvature, TestLineSearch) {
+    // f(x) = x . x from (1, -2) along -g: the unit step overshoots to (-1, 2), half lands on 0
+    auto x = std::make_shared<Value>(Value{1.0f, -2.0f});
+    Curvature::Parameters parameters{x};
+    Curvature::Objective objective = [&]() { return x->dot(*x); };
+    std::vector<float> direction{-2.0f, 4.0f};
+    float slope = -20.0f;
+    auto evaluate = [&]() { return Curvature::loss(objective); };
+
+    float step = 1.0f;
+    ASSERT_TRUE(Curvature::lineSearch(parameters, direction, 5.0f, slope, evaluate, step));
+    ASSERT_EQ(0.5f, step);
+    ASSERT_EQ(std::vector<float>({0.0f, 0.0f}), Curvature::getData(parameters));
+
+    // From the minimum no step decreases the loss, and the parameters are put back
+    step = 1.0f;
+    ASSERT_FALSE(Curvature::lineSearch(parameters, direction, 0.0f, slope, evaluate, step));
+    ASSERT_EQ(std::vector<float>({0.0f, 0.0f}), Curvature::getData(parameters));
+}
@@ -0,0 +1,142 @@
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "DataParallel.h"
+#include "Random.h"
+#include "SharedMemoryTransport.h"
+#include "TcpTransport.h"
+
+namespace {
+    // Run `body(rank)` on one thread per rank
+    void runRanks(size_t worldSize, const std::function<void(size_t)> &body) {
+        std::vector<std::thread> threads;
+        for (size_t rank = 0; rank < worldSize; ++rank) {
+            threads.emplace_back(body, rank);
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+    }
+
+    std::string uniqueName(const std::string &prefix) {
+        return "/smolgrad-test-" + prefix + "-" + std::to_string(getpid());
+    }
+
+    // Rank r contributes r + i at index i, so the mean is (worldSize - 1) / 2 + i
+    void checkAllReduce(Transport &transport, size_t size) {
+        std::vector<float> data(size);
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<float>(transport.getRank() + i);
+        }
+        transport.allReduce({data.data(), data.size()});
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_FLOAT_EQ(static_cast<float>(transport.getWorldSize() - 1) / 2.0f + static_cast<float>(i), data[i]);
+        }
+    }
+
+    // A peer that has gone away
+    class BrokenTransport : public Transport {
+    public:
+        size_t getRank() const override { return 0; }
+        size_t getWorldSize() const override { return 2; }
+        void send(size_t, const float *, size_t) override { throw std::runtime_error("connection lost"); }
+        void receive(size_t, float *, size_t) override { throw std::runtime_error("connection lost"); }
+    };
+}
+
+TEST(TestTransport, TestSharedMemoryAllReduce) {
+    auto name = uniqueName("threads");
+    runRanks(3, [&name](size_t rank) {
+        SharedMemoryTransport transport(name, rank, 3);
+        checkAllReduce(transport, 2);
+        checkAllReduce(transport, 100003);
+    });
+}
+
+TEST(TestTransport, TestSharedMemoryAcrossProcesses) {
+    auto name = uniqueName("processes");
+    pid_t child = fork();
+    if (child == 0) {
+        SharedMemoryTransport transport(name, 1, 2);
+        std::vector<float> data(5000, 3.0f);
+        transport.allReduce({data.data(), data.size()});
+        _exit(data[4999] == 2.0f ? 0 : 1);
+    }
+
+    SharedMemoryTransport transport(name, 0, 2);
+    std::vector<float> data(5000, 1.0f);
+    transport.allReduce({data.data(), data.size()});
+    EXPECT_EQ(2.0f, data[0]);
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+TEST(TestTransport, TestTcpLoopbackAllReduce) {
+    auto basePort = static_cast<uint16_t>(20000 + getpid() % 20000);
+    runRanks(3, [basePort](size_t rank) {
+        TcpTransport transport(rank, {"127.0.0.1", "127.0.0.1", "127.0.0.1"}, basePort);
+        checkAllReduce(transport, 7);
+        checkAllReduce(transport, 50000);
+        transport.barrier();
+    });
+}
+
+TEST(TestDataParallel, TestGradientsAreAveraged) {
+    // Each rank sees one sample; the averaged gradient must match one model on both
+    auto inputs = std::vector<Value> {Value {0.5f, 0.1f}, Value {-0.3f, 0.8f}};
+    auto targets = std::vector<Value> {Value {1.0f}, Value {-1.0f}};
+
+    Random::seed(3);
+    MultiLayerPerceptron reference(2, {5, 1});
+    for (size_t i = 0; i < 2; ++i) {
+        reference(inputs[i])->mse(targets[i])->backward();
+    }
+    auto referenceParameters = reference.getParameters();
+
+    std::vector<std::unique_ptr<MultiLayerPerceptron>> replicas;
+    for (size_t rank = 0; rank < 2; ++rank) {
+        Random::seed(3);
+        replicas.push_back(std::make_unique<MultiLayerPerceptron>(2, std::vector<size_t> {5, 1}));
+    }
+
+    auto name = uniqueName("data-parallel");
+    runRanks(2, [&](size_t rank) {
+        SharedMemoryTransport transport(name, rank, 2);
+        // Small buckets so several reductions overlap the backward pass
+        DataParallel parallel(*replicas[rank], transport, 4);
+        parallel.synchronizeParameters();
+        parallel.backward(*(*replicas[rank])(inputs[rank])->mse(targets[rank]));
+    });
+
+    for (size_t rank = 0; rank < 2; ++rank) {
+        auto parameters = replicas[rank]->getParameters();
+        for (size_t p = 0; p < parameters->size(); ++p) {
+            auto expected = (*referenceParameters)[p]->getGradSpan();
+            auto actual = (*parameters)[p]->getGradSpan();
+            for (size_t i = 0; i < actual.size(); ++i) {
+                EXPECT_NEAR(expected[i] / 2.0f, actual[i], 1e-6);
+            }
+        }
+    }
+}
+
+TEST(TestDataParallel, TestTransportErrorReachesCaller) {
+    Random::seed(4);
+    MultiLayerPerceptron model(2, {3, 1});
+    Value input{0.5f, 0.1f};
+    Value target{1.0f};
+    BrokenTransport transport;
+    DataParallel parallel(model, transport, 4);
+    ASSERT_THROW(parallel.backward(*model(input)->mse(target)), std::runtime_error);
+
+    // A failed pass leaves no communicator behind to confuse the next one
+    ASSERT_THROW(parallel.backward(*model(input)->mse(target)), std::runtime_error);
+}
@@ -0,0 +1,183 @@
+#include <cmath>
+#include <gtest/gtest.h>
+#include "Curvature.h"
+#include "Ensemble.h"
+#include "FiniteDifference.h"
+#include "MultiLayerPerceptron.h"
+#include "Random.h"
+
+namespace {
+    std::vector<float> dataOf(Value *value) {
+        auto data = value->getDataSpan();
+        return {data.begin(), data.end()};
+    }
+
+    std::vector<MultiLayerPerceptron> makeModels(size_t count, size_t nIn, const std::vector<size_t> &nOuts,
+                                                 const std::vector<Activation> &activations) {
+        std::vector<MultiLayerPerceptron> models;
+        for (size_t m = 0; m < count; ++m) {
+            models.emplace_back(nIn, nOuts, activations);
+        }
+        return models;
+    }
+}
+
+TEST(TestEnsemble, TestGroupedMse) {
+    Value x{1.0f, 2.0f, 3.0f, 5.0f};
+    Value target{0.0f, 2.0f, 1.0f, 1.0f};
+
+    // One group is the plain mean
+    ASSERT_NEAR(dataOf(x.mse(target))[0], dataOf(x.mse(target, 1))[0], 1e-6f);
+
+    auto losses = x.mse(target, 2);
+    ASSERT_EQ(losses->getSize(), 2u);
+    ASSERT_NEAR(0.5f, losses->at(0), 1e-6f);
+    ASSERT_NEAR(10.0f, losses->at(1), 1e-6f);
+
+    // Each group's gradient only sees its own loss
+    losses->sum()->backward();
+    auto grad = x.getGradSpan();
+    ASSERT_NEAR(1.0f, grad[0], 1e-6f);
+    ASSERT_NEAR(0.0f, grad[1], 1e-6f);
+    ASSERT_NEAR(2.0f, grad[2], 1e-6f);
+    ASSERT_NEAR(4.0f, grad[3], 1e-6f);
+
+    // A target of one group's size is shared by all groups
+    Value shared{1.0f, 2.0f};
+    auto sharedLosses = x.mse(shared, 2);
+    ASSERT_NEAR(0.0f, sharedLosses->at(0), 1e-6f);
+    ASSERT_NEAR(6.5f, sharedLosses->at(1), 1e-6f);
+
+    Value wrong{1.0f, 2.0f, 3.0f};
+    ASSERT_THROW(x.mse(wrong, 2), std::logic_error);
+}
+
+TEST(TestEnsemble, TestMatchesSeparateModels) {
+    Random::seed(21);
+    std::vector<Activation> activations{Activation::Tanh, Activation::ReLU, Activation::Sigmoid};
+    auto models = makeModels(5, 3, {6, 4, 2}, activations);
+    Ensemble ensemble(models);
+    ASSERT_EQ(ensemble.getMembers(), 5u);
+    ASSERT_EQ(ensemble.getNIn(), 3u);
+    ASSERT_EQ(ensemble.getNOut(), 2u);
+
+    Value input{0.4f, -0.2f, 0.9f};
+    input.setRequiresGrad(false);
+    Value target{0.3f, -0.1f};
+    target.setRequiresGrad(false);
+
+    // A shared input gives every member the same features
+    auto output = ensemble(input);
+    ASSERT_EQ(output->getSize(), 10u);
+    ensemble(input)->mse(target, 5)->sum()->backward();
+
+    auto parameters = ensemble.getParameters();
+    for (size_t m = 0; m < models.size(); ++m) {
+        auto expected = dataOf(models[m](input));
+        for (size_t j = 0; j < 2; ++j) {
+            ASSERT_NEAR(expected[j], output->at(m * 2 + j), 1e-5f);
+        }
+
+        models[m](input)->mse(target)->backward();
+        auto &layers = models[m].getLayers();
+        for (size_t l = 0; l < layers.size(); ++l) {
+            auto neurons = layers[l]->getParameters();
+            auto weightsGrad = (*parameters)[2 * l]->getGradSpan();
+            auto biasGrad = (*parameters)[2 * l + 1]->getGradSpan();
+            size_t nIn = layers[l]->getNIn();
+            size_t nOut = layers[l]->getNOut();
+            for (size_t o = 0; o < nOut; ++o) {
+                auto weightGrad = (*neurons)[2 * o]->getGradSpan();
+                for (size_t i = 0; i < nIn; ++i) {
+                    ASSERT_NEAR(weightGrad[i], weightsGrad[(m * nOut + o) * nIn + i], 1e-5f);
+                }
+                ASSERT_NEAR((*neurons)[2 * o + 1]->getGradSpan()[0], biasGrad[m * nOut + o], 1e-5f);
+            }
+        }
+    }
+}
+
+TEST(TestEnsemble, TestPerMemberInputs) {
+    Random::seed(22);
+    Ensemble ensemble(3, 2, {4, 1});
+
+    Value inputs{0.1f, 0.2f, -0.5f, 0.5f, 1.0f, -1.0f};
+    auto output = ensemble(inputs);
+    ASSERT_EQ(output->getSize(), 3u);
+    for (size_t m = 0; m < 3; ++m) {
+        auto member = ensemble.getMember(m);
+        Value input{inputs.at(2 * m), inputs.at(2 * m + 1)};
+        ASSERT_NEAR(dataOf(member(input))[0], output->at(m), 1e-5f);
+    }
+
+    Value wrong{0.1f, 0.2f, 0.3f};
+    ASSERT_THROW(ensemble(wrong), std::logic_error);
+    ASSERT_THROW(ensemble.getMember(3), std::out_of_range);
+}
+
+TEST(TestEnsemble, TestIndependentLearningRates) {
+    Random::seed(23);
+    auto models = makeModels(3, 2, {5, 1}, {Activation::Tanh, Activation::Tanh});
+    Ensemble ensemble(models);
+    std::vector<float> learningRates{0.0f, 0.05f, 0.2f};
+    auto initial = Curvature::getData(*ensemble.getMember(0).getParameters());
+
+    std::vector<Value> inputs{{0.5f, -0.5f}, {-0.3f, 0.8f}, {0.9f, 0.1f}};
+    std::vector<Value> targets{{0.2f}, {-0.4f}, {0.7f}};
+    for (size_t step = 0; step < 10; ++step) {
+        auto &input = inputs[step % inputs.size()];
+        auto &target = targets[step % targets.size()];
+
+        Value::clearGrads();
+        ensemble(input)->mse(target, 3)->sum()->backward();
+        ensemble.step(learningRates);
+
+        for (size_t m = 0; m < models.size(); ++m) {
+            models[m](input)->mse(target)->backward();
+            auto parameters = models[m].getParameters();
+            for (auto &parameter: *parameters) {
+                parameter->step(learningRates[m]);
+            }
+        }
+    }
+
+    for (size_t m = 0; m < models.size(); ++m) {
+        auto expected = Curvature::getData(*models[m].getParameters());
+        auto actual = Curvature::getData(*ensemble.getMember(m).getParameters());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_NEAR(expected[i], actual[i], 1e-5f);
+        }
+    }
+
+    // A zero learning rate leaves its member untouched
+    ASSERT_EQ(initial, Curvature::getData(*ensemble.getMember(0).getParameters()));
+}
+
+TEST(TestEnsemble, TestHessianVectorProduct) {
+    // stackedAffine and grouped mse propagate gradient tangents like every other op
+    Random::seed(24);
+    Ensemble ensemble(2, 3, {4, 2}, {Activation::Tanh, Activation::Sigmoid});
+    auto parameters = ensemble.getParameters();
+    Value input{0.5f, -0.3f, 0.8f};
+    input.setRequiresGrad(false);
+    Value target{0.1f, 0.9f};
+    target.setRequiresGrad(false);
+    Curvature::Objective objective = [&]() { return ensemble(input)->mse(target, 2)->sum(); };
+
+    auto v = randomDirection(Curvature::getSize(*parameters));
+    auto product = Curvature::hessianVectorProduct(*parameters, objective, v);
+    auto expected = finiteDifference(*parameters, objective, v, 1e-2f);
+    for (size_t i = 0; i < product.size(); ++i) {
+        ASSERT_NEAR(expected[i], product[i], 2e-3f + 2e-2f * std::fabs(expected[i]));
+    }
+}
+
+TEST(TestEnsemble, TestArchitectureMismatch) {
+    std::vector<MultiLayerPerceptron> models;
+    models.emplace_back(2, std::vector<size_t>{3, 1});
+    models.emplace_back(2, std::vector<size_t>{4, 1});
+    ASSERT_THROW(Ensemble{models}, std::logic_error);
+
+    std::vector<MultiLayerPerceptron> none;
+    ASSERT_THROW(Ensemble{none}, std::logic_error);
+}
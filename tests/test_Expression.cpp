@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "Expression.h"
+#include "Value.h"
+
+TEST(TestExpression, TestMatchesOperatorChain) {
+    Value a{1.0f, -2.0f, 0.5f};
+    Value b{3.0f, 0.25f, -1.0f};
+    Value c{0.5f, 1.5f, 2.0f};
+
+    // tanh(a * b + c) / (b - 2) * 3
+    auto chained = *(*(*(a * b) + c)->tanh() / *(b - 2.0f)) * 3.0f;
+    chained->sum()->backward();
+    std::vector<float> gradA(a.getGradSpan().begin(), a.getGradSpan().end());
+    std::vector<float> gradB(b.getGradSpan().begin(), b.getGradSpan().end());
+    std::vector<float> gradC(c.getGradSpan().begin(), c.getGradSpan().end());
+    Value::clearGrads();
+
+    auto fused = Expression::evaluate(Expression::tanh(Expression::leaf(a) * b + c) / (Expression::leaf(b) - 2.0f) * 3);
+    fused->sum()->backward();
+
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_NEAR(chained->at(i), fused->at(i), 1e-6);
+        ASSERT_NEAR(gradA[i], a.getGradSpan()[i], 1e-5);
+        ASSERT_NEAR(gradB[i], b.getGradSpan()[i], 1e-5);
+        ASSERT_NEAR(gradC[i], c.getGradSpan()[i], 1e-5);
+    }
+}
+
+TEST(TestExpression, TestUnaryOps) {
+    Value a{-1.0f, 0.5f, 2.0f};
+    auto fused = Expression::evaluate(-Expression::exp(Expression::leaf(a)) + Expression::relu(Expression::leaf(a)) +
+                                      Expression::sigmoid(Expression::leaf(a)) + 1.0f / Expression::leaf(a));
+    fused->sum()->backward();
+
+    for (size_t i = 0; i < 3; ++i) {
+        float x = a.at(i);
+        float s = 1.0f / (1.0f + std::exp(-x));
+        ASSERT_NEAR(-std::exp(x) + std::max(x, 0.0f) + s + 1.0f / x, fused->at(i), 1e-5);
+        ASSERT_NEAR(-std::exp(x) + (x > 0.0f ? 1.0f : 0.0f) + s * (1.0f - s) - 1.0f / (x * x),
+                    a.getGradSpan()[i], 1e-5);
+    }
+}
+
+TEST(TestExpression, TestSingleNode) {
+    Value a(1000), b(1000), c(1000);
+    size_t before = Value::getLiveCount();
+    auto fused = Expression::evaluate(Expression::leaf(a) * b + c);
+    ASSERT_EQ(before + 1, Value::getLiveCount());
+
+    // Only the operands are referenced, each pointing straight into their buffers
+    fused->sum()->backward();
+    ASSERT_TRUE(a.hasGrad());
+    ASSERT_TRUE(c.hasGrad());
+}
+
+TEST(TestExpression, TestRequiresGradAndNoGrad) {
+    Value a{1.0f, 2.0f};
+    Value b{3.0f, 4.0f};
+    b.setRequiresGrad(false);
+    Expression::evaluate(Expression::leaf(a) * b)->sum()->backward();
+    ASSERT_EQ(3.0f, a.getGradSpan()[0]);
+    ASSERT_FALSE(b.hasGrad());
+
+    Value::NoGrad noGrad;
+    ASSERT_FALSE(Expression::evaluate(Expression::leaf(a) * a)->getRequiresGrad());
+}
+
+TEST(TestExpression, TestOutputSlice) {
+    Value a{1.0f, 2.0f};
+    Value buffer(4);
+    auto out = buffer.outputSlice(2, 2);
+    ASSERT_EQ(out, Expression::evaluate(Expression::leaf(a) * a, out));
+    ASSERT_EQ(4.0f, buffer.at(3));
+    out->sum()->backward();
+    ASSERT_EQ(4.0f, a.getGradSpan()[1]);
+}
+
+TEST(TestExpression, TestTangent) {
+    Value a{1.0f, 2.0f};
+    Value b{3.0f, 4.0f};
+    a.getTangentSpan()[0] = 1.0f;
+    a.getTangentSpan()[1] = 1.0f;
+    auto fused = Expression::evaluate(Expression::leaf(a) * b + Expression::exp(Expression::leaf(a)));
+    ASSERT_NEAR(3.0f + std::exp(1.0f), fused->getTangentSpan()[0], 1e-5);
+    ASSERT_NEAR(4.0f + std::exp(2.0f), fused->getTangentSpan()[1], 1e-5);
+}
+
+TEST(TestExpression, TestSizeMismatch) {
+    Value a(2), b(3);
+    ASSERT_THROW(Expression::leaf(a) + b, std::logic_error);
+    ASSERT_THROW(Expression::evaluate(Expression::Scalar(1.0f) + 2.0f), std::logic_error);
+}
@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "BlockSparseLayer.h"
+#include "InferenceCache.h"
+#include "MultiLayerPerceptron.h"
+#include "Random.h"
+
+namespace {
+    std::vector<float> dataOf(Value *value) {
+        auto data = value->getDataSpan();
+        return {data.begin(), data.end()};
+    }
+
+    std::vector<float> reference(MultiLayerPerceptron &mlp, Value &input) {
+        Value::NoGrad noGrad;
+        return dataOf(mlp(input));
+    }
+}
+
+TEST(TestInferenceCache, TestVersionBumpedByWrites) {
+    Value value({1.0f, 2.0f});
+    auto version = value.getVersion();
+
+    value[0] = 3.0f;
+    value.markModified();
+    EXPECT_GT(value.getVersion(), version);
+    version = value.getVersion();
+
+    // Reads leave the version alone, through non-const accessors too
+    EXPECT_FLOAT_EQ(value.at(0), 3.0f);
+    EXPECT_FLOAT_EQ(value[0], 3.0f);
+    value.getDataSpan();
+    EXPECT_EQ(value.getVersion(), version);
+
+    value.getGradSpan()[0] = 1.0f;
+    value.step(0.1f);
+    EXPECT_GT(value.getVersion(), version);
+    version = value.getVersion();
+
+    Value other({1.0f, 1.0f});
+    value += other;
+    EXPECT_GT(value.getVersion(), version);
+
+    // Views share their parent's version
+    auto view = value.slice(1, 1);
+    version = value.getVersion();
+    view->getDataSpan()[0] = 0.0f;
+    view->markModified();
+    EXPECT_GT(value.getVersion(), version);
+    delete view;
+
+    // Assigning a fresh value does not take the version backwards
+    version = value.getVersion();
+    value = Value({5.0f, 6.0f});
+    EXPECT_GT(value.getVersion(), version);
+}
+
+TEST(TestInferenceCache, TestHitsMatchModel) {
+    Random::seed(1);
+    MultiLayerPerceptron mlp(3, {8, 2});
+    InferenceCache cache(mlp);
+
+    Value a({0.1f, 0.2f, 0.3f});
+    Value b({-1.0f, 0.5f, 2.0f});
+    auto expectedA = reference(mlp, a);
+    auto expectedB = reference(mlp, b);
+
+    EXPECT_EQ(dataOf(cache(a)), expectedA);
+    EXPECT_EQ(dataOf(cache(b)), expectedB);
+    EXPECT_EQ(cache.getMisses(), 2u);
+    EXPECT_EQ(cache.getHits(), 0u);
+
+    // Equal data in a different Value hits as well
+    Value sameAsA({0.1f, 0.2f, 0.3f});
+    auto result = cache(sameAsA);
+    EXPECT_EQ(dataOf(result), expectedA);
+    EXPECT_FALSE(result->getRequiresGrad());
+    EXPECT_EQ(cache.getHits(), 1u);
+
+    Value output(2);
+    EXPECT_EQ(cache(b, &output), &output);
+    EXPECT_EQ(dataOf(&output), expectedB);
+    EXPECT_EQ(cache.getHits(), 2u);
+    EXPECT_EQ(cache.getEntries(), 2u);
+
+    Value wrongSize(3);
+    EXPECT_THROW(cache(b, &wrongSize), std::logic_error);
+}
+
+TEST(TestInferenceCache, TestInvalidatedByParameterUpdates) {
+    Random::seed(2);
+    MultiLayerPerceptron mlp(2, {4, 1});
+    InferenceCache cache(mlp);
+    auto parameters = mlp.getParameters();
+    Value input({0.5f, -0.5f});
+
+    auto before = dataOf(cache(input));
+    cache(input);
+    EXPECT_EQ(cache.getHits(), 1u);
+
+    // A training step changes the parameters
+    auto loss = mlp(input)->sum();
+    loss->backward();
+    for (auto &parameter: *parameters) {
+        parameter->step(0.5f);
+    }
+
+    auto after = dataOf(cache(input));
+    EXPECT_EQ(after, reference(mlp, input));
+    EXPECT_NE(after, before);
+    EXPECT_EQ(cache.getHits(), 1u);
+    EXPECT_EQ(cache.getMisses(), 2u);
+    EXPECT_EQ(cache.getInvalidations(), 1u);
+
+    // So does writing a weight directly
+    (*(*parameters)[0])[0] += 1.0f;
+    (*parameters)[0]->markModified();
+    EXPECT_EQ(dataOf(cache(input)), reference(mlp, input));
+    EXPECT_EQ(cache.getMisses(), 3u);
+
+    // Even through a span taken before the entry was cached
+    auto weights = (*parameters)[0]->getDataSpan();
+    cache(input);
+    weights[0] -= 1.0f;
+    (*parameters)[0]->markModified();
+    EXPECT_EQ(dataOf(cache(input)), reference(mlp, input));
+    EXPECT_EQ(cache.getMisses(), 4u);
+}
+
+TEST(TestInferenceCache, TestReadsKeepEntries) {
+    Random::seed(5);
+    MultiLayerPerceptron mlp(2, {4, 1});
+    InferenceCache cache(mlp);
+    Value input({0.5f, -0.5f});
+    cache(input);
+
+    // Exporting the weights only reads them
+    std::ostringstream header;
+    mlp.generateHeader(header, "model");
+    BlockSparseLayer compressed(*mlp.getLayers()[0]);
+    std::ostringstream saved;
+    mlp.save(saved);
+
+    cache(input);
+    EXPECT_EQ(cache.getHits(), 1u);
+    EXPECT_EQ(cache.getInvalidations(), 0u);
+}
+
+TEST(TestInferenceCache, TestMemoryCap) {
+    Random::seed(3);
+    MultiLayerPerceptron mlp(16, {4});
+    InferenceCache::Options options;
+    options.shards = 4;
+    options.maxBytes = 4096;
+    InferenceCache cache(mlp, options);
+
+    std::vector<Value> inputs;
+    for (int i = 0; i < 200; ++i) {
+        inputs.push_back(Value::constant(16, static_cast<float>(i)));
+    }
+    for (auto &input: inputs) {
+        cache(input);
+        EXPECT_LE(cache.getBytes(), options.maxBytes);
+    }
+    EXPECT_EQ(cache.getMisses(), 200u);
+    EXPECT_GT(cache.getEvictions(), 0u);
+    EXPECT_EQ(cache.getEntries() + cache.getEvictions(), 200u);
+
+    // The most recent input is still there, the first one is long gone
+    cache(inputs.back());
+    EXPECT_EQ(cache.getHits(), 1u);
+    cache(inputs.front());
+    EXPECT_EQ(cache.getMisses(), 201u);
+
+    cache.clear();
+    EXPECT_EQ(cache.getBytes(), 0u);
+    EXPECT_EQ(cache.getEntries(), 0u);
+}
+
+TEST(TestInferenceCache, TestConcurrentLookups) {
+    Random::seed(4);
+    MultiLayerPerceptron mlp(4, {8, 3});
+    InferenceCache cache(mlp);
+
+    std::vector<Value> inputs;
+    std::vector<std::vector<float>> expected;
+    for (int i = 0; i < 16; ++i) {
+        inputs.push_back(Value::constant(4, 0.1f * static_cast<float>(i)));
+        expected.push_back(reference(mlp, inputs.back()));
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<int> mismatches(4, 0);
+    for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            Value output(3);
+            for (int round = 0; round < 50; ++round) {
+                for (size_t i = 0; i < inputs.size(); ++i) {
+                    if (dataOf(cache(inputs[i], &output)) != expected[i]) {
+                        ++mismatches[t];
+                    }
+                }
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    for (int count: mismatches) {
+        EXPECT_EQ(count, 0);
+    }
+    EXPECT_EQ(cache.getHits() + cache.getMisses(), 4u * 50u * 16u);
+    EXPECT_EQ(cache.getEntries(), 16u);
+}
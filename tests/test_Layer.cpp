@@ -20,4 +20,16 @@ TEST(TestLayerFunctor, TestLayerFunctorShape) {
     auto output = layer(input);
 
     EXPECT_EQ(output->getData()->size(), 20);
-}
\ No newline at end of file
+}
+
+TEST(TestLayerFunctor, TestLayerFunctorBackward) {
+    Layer layer(3, 4);
+    auto input = Value::constant(3, 1.0f);
+    auto output = layer(input);
+    output->sum()->backward();
+
+    auto parameters = layer.getParameters();
+    for (auto &parameter : *parameters) {
+        EXPECT_TRUE(parameter->hasGrad());
+    }
+}
@@ -69,3 +69,90 @@ TEST(FOO, BAR) {
     }
 
 }
+
+TEST(TestMultiLayerPerceptronTraining, TestLossDecreases) {
+    MultiLayerPerceptron mlp(2, {8, 8, 1});
+
+    auto inputs = std::vector<Value> {
+            Value {0.5f, 0.1f},
+            Value {0.7f, 1.0f},
+            Value {-0.5f, -0.1f},
+            Value {-0.3f, 0.2f}
+    };
+    auto expected = Value {1.0f, 0.0f, 1.0f, 1.0f};
+    expected.setRequiresGrad(false);
+
+    float first = 0.0f;
+    float last = 0.0f;
+    for (size_t step = 0; step < 50; ++step) {
+        Value predictions(inputs.size());
+        std::vector<Value *> observed;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            observed.push_back(mlp(inputs[i], predictions.outputSlice(i, 1)));
+        }
+
+        auto diff = *Value::concat(observed) - expected;
+        auto loss = diff->dot(*diff);
+        loss->backward();
+
+        last = loss->at(0);
+        if (step == 0) {
+            first = last;
+        }
+
+        auto parameters = mlp.getParameters();
+        for (auto &parameter : *parameters) {
+            auto data = parameter->getDataSpan();
+            auto grad = parameter->getGradSpan();
+            for (size_t i = 0; i < data.size(); ++i) {
+                data[i] -= 0.05f * grad[i];
+            }
+        }
+        Value::clearGrads();
+    }
+
+    EXPECT_LT(last, first);
+}
+
+TEST(TestMultiLayerPerceptronConstructor, TestActivationsPerLayer) {
+    MultiLayerPerceptron mlp(3, {4, 2}, {Activation::ReLU, Activation::Sigmoid});
+    auto input = Value::constant(3, 1.0f);
+    auto output = mlp(input);
+    ASSERT_EQ(2, output->getSize());
+
+    ASSERT_THROW(MultiLayerPerceptron(3, {4, 2}, {Activation::ReLU}), std::logic_error);
+}
+
+TEST(TestMultiLayerPerceptronJacobian, TestMatchesFiniteDifferences) {
+    MultiLayerPerceptron mlp(3, {6, 2}, {Activation::GELU, Activation::Tanh});
+    Value input {0.2f, -0.4f, 0.9f};
+
+    auto jacobian = mlp.jacobian(input);
+    ASSERT_EQ(2, jacobian.size());
+    ASSERT_EQ(3, jacobian[0].size());
+    ASSERT_FALSE(input.hasTangent());
+
+    const float h = 1e-2f;
+    for (size_t j = 0; j < 3; j++) {
+        Value up(input);
+        Value down(input);
+        up[j] += h;
+        down[j] -= h;
+        auto upOutput = *mlp(up)->getData();
+        auto downOutput = *mlp(down)->getData();
+        for (size_t i = 0; i < 2; i++) {
+            EXPECT_NEAR((upOutput[i] - downOutput[i]) / (2.0f * h), jacobian[i][j], 1e-3);
+        }
+    }
+}
+
+TEST(TestMultiLayerPerceptronJacobian, TestDoesNotTouchGradients) {
+    MultiLayerPerceptron mlp(2, {4, 1});
+    Value input {0.5f, 0.1f};
+    mlp.jacobian(input);
+
+    auto parameters = mlp.getParameters();
+    for (auto &parameter : *parameters) {
+        EXPECT_FALSE(parameter->hasGrad());
+    }
+}
@@ -12,4 +12,20 @@ TEST(TestFunctor, TestFunctorDoesNotRaise) {
     Neuron neuron(10);
     auto input = Value::constant(10, 1.0f);
     neuron(input);
-}
\ No newline at end of file
+}
+
+TEST(TestFunctor, TestActivations) {
+    auto input = Value::constant(10, 1.0f);
+    for (auto activation : {Activation::Tanh, Activation::ReLU, Activation::GELU, Activation::Sigmoid}) {
+        Neuron neuron(10, activation);
+        auto output = neuron(input);
+        ASSERT_EQ(1, output->getSize());
+        if (activation == Activation::ReLU) {
+            EXPECT_GE(output->at(0), 0.0f);
+        }
+        if (activation == Activation::Sigmoid) {
+            EXPECT_GT(output->at(0), 0.0f);
+            EXPECT_LT(output->at(0), 1.0f);
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#include <cmath>
+#include <vector>
+#include <gtest/gtest.h>
+#include "BlockSparseLayer.h"
+#include "Pruner.h"
+
+namespace {
+    size_t countZeros(Layer &layer) {
+        size_t zeros = 0;
+        auto parameters = layer.getParameters();
+        for (size_t p = 0; p < parameters->size(); p += 2) {
+            for (auto x : (*parameters)[p]->getDataSpan()) {
+                zeros += x == 0.0f;
+            }
+        }
+        return zeros;
+    }
+}
+
+TEST(TestPruner, TestPruneGlobal) {
+    MultiLayerPerceptron mlp(10, {20, 5});
+    Pruner pruner(mlp);
+    pruner.pruneGlobal(0.5f);
+
+    EXPECT_NEAR(0.5f, pruner.getSparsity(), 1e-6);
+    auto &layers = mlp.getLayers();
+    EXPECT_EQ(150, countZeros(*layers[0]) + countZeros(*layers[1]));
+
+    // Pruning further keeps the earlier mask and extends it
+    pruner.pruneGlobal(0.9f);
+    EXPECT_NEAR(0.9f, pruner.getSparsity(), 1e-6);
+}
+
+TEST(TestPruner, TestPruneLayers) {
+    MultiLayerPerceptron mlp(10, {20, 5});
+    Pruner pruner(mlp);
+    pruner.pruneLayers({0.25f, 0.8f});
+
+    auto &layers = mlp.getLayers();
+    EXPECT_EQ(50, countZeros(*layers[0]));
+    EXPECT_EQ(80, countZeros(*layers[1]));
+
+    ASSERT_THROW(pruner.pruneLayers({0.5f}), std::logic_error);
+    ASSERT_THROW(pruner.pruneGlobal(1.5f), std::out_of_range);
+}
+
+TEST(TestPruner, TestFineTuneUnderMask) {
+    MultiLayerPerceptron mlp(4, {6, 1});
+    Pruner pruner(mlp);
+    pruner.pruneGlobal(0.5f);
+
+    Value input {1.0f, -1.0f, 0.5f, 2.0f};
+    Value target {0.3f};
+    mlp(input)->mse(target)->backward();
+    auto parameters = mlp.getParameters();
+    for (auto &parameter : *parameters) {
+        parameter->step(0.1f);
+    }
+    pruner.applyMask();
+
+    auto &layers = mlp.getLayers();
+    EXPECT_EQ(15, countZeros(*layers[0]) + countZeros(*layers[1]));
+}
+
+TEST(TestBlockSparseLayer, TestMatchesLayer) {
+    for (auto activation : {Activation::Tanh, Activation::ReLU, Activation::GELU, Activation::Sigmoid}) {
+        for (float sparsity : {0.0f, 0.5f, 0.95f}) {
+            MultiLayerPerceptron mlp(11, {7}, {activation});
+            Pruner pruner(mlp);
+            pruner.pruneGlobal(sparsity);
+
+            auto &layer = *mlp.getLayers()[0];
+            BlockSparseLayer compressed(layer);
+            EXPECT_LE(compressed.getDensity(), 1.0f);
+
+            std::vector<float> input(11);
+            for (size_t i = 0; i < input.size(); i++) {
+                input[i] = std::sin(static_cast<float>(i));
+            }
+            std::vector<float> output(7);
+            compressed(input.data(), output.data());
+
+            Value value(input.size(), input.data());
+            auto expected = layer(value);
+            for (size_t o = 0; o < output.size(); o++) {
+                EXPECT_NEAR(expected->at(o), output[o], 1e-5);
+            }
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#include <vector>
+#include <gtest/gtest.h>
+#include "Random.h"
+#include "Value.h"
+
+TEST(TestRandom, TestSeedIsReproducible) {
+    Random::seed(42);
+    auto a = Value::rand(100, -1.0f, 1.0f);
+    auto b = Value::randn(100, 0.0f, 1.0f);
+
+    Random::seed(42);
+    auto c = Value::rand(100, -1.0f, 1.0f);
+    auto d = Value::randn(100, 0.0f, 1.0f);
+
+    ASSERT_EQ(*a.getData(), *c.getData());
+    ASSERT_EQ(*b.getData(), *d.getData());
+    ASSERT_NE(*a.getData(), *Value::rand(100, -1.0f, 1.0f).getData());
+}
+
+TEST(TestRandom, TestIndependentOfThreadCount) {
+    std::vector<float> serial(200003);
+    std::vector<float> parallel(serial.size());
+
+    Random::normal({serial.data(), serial.size()}, 0.0f, 1.0f, 7, 3, 1);
+    Random::normal({parallel.data(), parallel.size()}, 0.0f, 1.0f, 7, 3, 5);
+    ASSERT_EQ(serial, parallel);
+
+    Random::uniform({serial.data(), serial.size()}, 0.0f, 1.0f, 7, 3, 1);
+    Random::uniform({parallel.data(), parallel.size()}, 0.0f, 1.0f, 7, 3, 3);
+    ASSERT_EQ(serial, parallel);
+}
+
+TEST(TestRandom, TestUniformRange) {
+    auto value = Value::rand(10000, -2.0f, 3.0f);
+    float sum = 0.0f;
+    for (auto x : value.getDataSpan()) {
+        ASSERT_GE(x, -2.0f);
+        ASSERT_LT(x, 3.0f);
+        sum += x;
+    }
+    EXPECT_NEAR(0.5f, sum / 10000.0f, 0.05f);
+}
+
+TEST(TestRandom, TestNormalMoments) {
+    auto value = Value::randn(10000, 1.0f, 2.0f);
+    float sum = 0.0f;
+    float squares = 0.0f;
+    for (auto x : value.getDataSpan()) {
+        sum += x;
+        squares += x * x;
+    }
+    float mean = sum / 10000.0f;
+    EXPECT_NEAR(1.0f, mean, 0.1f);
+    EXPECT_NEAR(4.0f, squares / 10000.0f - mean * mean, 0.2f);
+}
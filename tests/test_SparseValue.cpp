@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include "Layer.h"
+#include "MultiLayerPerceptron.h"
+#include "SparseValue.h"
+
+TEST(TestSparseValue, TestConstructor) {
+    SparseValue value(10, {1, 7}, {2.0f, -1.0f});
+    ASSERT_EQ(10, value.getSize());
+    ASSERT_EQ(2, value.getNonZeros());
+
+    auto dense = value.toDense();
+    ASSERT_EQ(2.0f, dense[1]);
+    ASSERT_EQ(-1.0f, dense[7]);
+    ASSERT_EQ(0.0f, dense[0]);
+
+    ASSERT_THROW(SparseValue(10, {10}, {1.0f}), std::out_of_range);
+    ASSERT_THROW(SparseValue(10, {1, 2}, {1.0f}), std::logic_error);
+}
+
+TEST(TestSparseValue, TestFromDense) {
+    Value dense {0.0f, 3.0f, 0.0f, 4.0f};
+    auto sparse = SparseValue::fromDense(dense);
+    ASSERT_EQ(2, sparse.getNonZeros());
+    ASSERT_EQ(3, sparse.getIndices()[1]);
+    ASSERT_EQ(4.0f, sparse.getValues()[1]);
+}
+
+TEST(TestSparseValue, TestDotMatchesDense) {
+    auto weight = new Value {1.0f, 2.0f, 3.0f, 4.0f};
+    SparseValue sparse(4, {0, 2}, {5.0f, -1.0f});
+
+    auto c = weight->dot(sparse);
+    ASSERT_EQ(2.0f, c->at(0));
+
+    (*c * 3.0f)->backward();
+    auto grad = *weight->getGrad()->getData();
+    ASSERT_EQ(15.0f, grad[0]);
+    ASSERT_EQ(0.0f, grad[1]);
+    ASSERT_EQ(-3.0f, grad[2]);
+    ASSERT_EQ(0.0f, grad[3]);
+}
+
+TEST(TestSparseValue, TestSparseStep) {
+    auto weight = new Value {1.0f, 2.0f, 3.0f};
+    SparseValue sparse(3, {1}, {2.0f});
+    weight->dot(sparse)->backward();
+
+    ASSERT_TRUE(weight->hasGrad());
+    weight->step(0.5f);
+    ASSERT_EQ(1.0f, weight->at(0));
+    ASSERT_EQ(1.0f, weight->at(1));
+    ASSERT_EQ(3.0f, weight->at(2));
+
+    weight->clearGrad();
+    ASSERT_FALSE(weight->hasGrad());
+}
+
+TEST(TestSparseValue, TestLayerMatchesDense) {
+    Layer layer(50, 4, Activation::Sigmoid);
+    SparseValue sparse(50, {3, 17, 42}, {1.0f, 0.5f, -2.0f});
+    auto dense = sparse.toDense();
+    dense.setRequiresGrad(false);
+
+    auto sparseOutput = layer(sparse);
+    auto denseOutput = layer(dense);
+    for (size_t i = 0; i < 4; i++) {
+        EXPECT_NEAR(denseOutput->at(i), sparseOutput->at(i), 1e-6);
+    }
+
+    // Same gradient through either kernel
+    auto parameters = layer.getParameters();
+    sparseOutput->sum()->backward();
+    std::vector<std::vector<float>> sparseGrads;
+    for (auto &parameter : *parameters) {
+        sparseGrads.push_back(*parameter->getGrad()->getData());
+    }
+    Value::clearGrads();
+
+    denseOutput->sum()->backward();
+    for (size_t p = 0; p < parameters->size(); p++) {
+        auto denseGrad = *(*parameters)[p]->getGrad()->getData();
+        for (size_t i = 0; i < denseGrad.size(); i++) {
+            EXPECT_NEAR(denseGrad[i], sparseGrads[p][i], 1e-6);
+        }
+    }
+}
+
+TEST(TestSparseValue, TestMultiLayerPerceptron) {
+    MultiLayerPerceptron mlp(100, {8, 2});
+    SparseValue sparse(100, {5, 60}, {1.0f, 1.0f});
+    auto dense = sparse.toDense();
+
+    auto sparseOutput = mlp(sparse);
+    auto denseOutput = mlp(dense);
+    ASSERT_EQ(2, sparseOutput->getSize());
+    EXPECT_NEAR(denseOutput->at(0), sparseOutput->at(0), 1e-6);
+    EXPECT_NEAR(denseOutput->at(1), sparseOutput->at(1), 1e-6);
+}
@@ -0,0 +1,189 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+#include "Allocator.h"
+#include "MultiLayerPerceptron.h"
+#include "RingBuffer.h"
+#include "SparseValue.h"
+#include "Telemetry.h"
+#include "Value.h"
+
+namespace {
+    size_t countLines(const std::string &path) {
+        std::ifstream in(path);
+        size_t lines = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            ++lines;
+        }
+        return lines;
+    }
+
+    std::string readFile(const std::string &path) {
+        std::ifstream in(path);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+}
+
+TEST(TestTelemetry, TestRingBuffer) {
+    RingBuffer<int, 4> ring;
+    int item = 0;
+    ASSERT_FALSE(ring.pop(item));
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(ring.push(i));
+    }
+    ASSERT_FALSE(ring.push(4));
+    ASSERT_TRUE(ring.pop(item));
+    ASSERT_EQ(0, item);
+    ASSERT_TRUE(ring.push(4));
+    for (int i = 1; i <= 4; ++i) {
+        ASSERT_TRUE(ring.pop(item));
+        ASSERT_EQ(i, item);
+    }
+    ASSERT_FALSE(ring.pop(item));
+}
+
+TEST(TestTelemetry, TestLiveCounts) {
+    size_t values = Value::getLiveCount();
+    size_t bytes = Allocator::getLiveBytes();
+    {
+        Value a(100);
+        Value b(a);
+        ASSERT_EQ(values + 2, Value::getLiveCount());
+        ASSERT_EQ(bytes + 800, Allocator::getLiveBytes());
+    }
+    ASSERT_EQ(values, Value::getLiveCount());
+    ASSERT_EQ(bytes, Allocator::getLiveBytes());
+}
+
+TEST(TestTelemetry, TestGradientNorm) {
+    MultiLayerPerceptron mlp(2, {3, 1});
+    Value input{1.0f, -1.0f};
+    mlp(input)->backward();
+    auto parameters = mlp.getParameters();
+
+    double sum = 0.0;
+    for (auto &parameter: *parameters) {
+        for (auto grad: parameter->getGradSpan()) {
+            sum += grad * grad;
+        }
+    }
+    ASSERT_NEAR(std::sqrt(sum), Telemetry::gradientNorm(*parameters), 1e-5);
+    ASSERT_GT(Telemetry::getPeakRss(), 0u);
+}
+
+TEST(TestTelemetry, TestGradientNormKeepsSparseGradients) {
+    auto weight = std::make_shared<Value>(Value{1.0f, 2.0f, 3.0f});
+    SparseValue sparse(3, {1}, {2.0f});
+    // Two backward passes leave two entries for the same index
+    weight->dot(sparse)->backward();
+    weight->dot(sparse)->backward();
+
+    ASSERT_NEAR(4.0f, Telemetry::gradientNorm({weight}), 1e-6);
+    ASSERT_TRUE(weight->getDenseGradSpan().empty());
+    ASSERT_EQ(2u, weight->getSparseGrad().size());
+    Value::clearGrads();
+}
+
+TEST(TestTelemetry, TestExport) {
+    Telemetry::Options options;
+    options.jsonPath = "test_telemetry.jsonl";
+    options.prometheusPath = "test_telemetry.prom";
+    std::remove(options.jsonPath.c_str());
+    {
+        Telemetry telemetry(options);
+        for (size_t i = 0; i < 10; ++i) {
+            Telemetry::Step step;
+            step.step = i;
+            step.samples = 8;
+            step.forwardSeconds = 0.25;
+            step.backwardSeconds = 0.5;
+            step.optimizerSeconds = 0.25;
+            step.loss = 1.5f;
+            telemetry.record(step);
+        }
+        telemetry.flush();
+        ASSERT_EQ(0u, telemetry.getDropped());
+    }
+    ASSERT_EQ(10u, countLines(options.jsonPath));
+
+    auto json = readFile(options.jsonPath);
+    ASSERT_NE(std::string::npos, json.find("{\"step\":9,\"samples\":8,\"samples_per_second\":8,"));
+    ASSERT_NE(std::string::npos, json.find("\"loss\":1.5"));
+
+    auto prometheus = readFile(options.prometheusPath);
+    ASSERT_NE(std::string::npos, prometheus.find("smolgrad_steps_total 10\n"));
+    ASSERT_NE(std::string::npos, prometheus.find("smolgrad_samples_total 80\n"));
+    ASSERT_NE(std::string::npos, prometheus.find("smolgrad_step_seconds{phase=\"backward\"} 0.5\n"));
+    ASSERT_NE(std::string::npos, prometheus.find("# TYPE smolgrad_loss gauge\n"));
+
+    std::remove(options.jsonPath.c_str());
+    std::remove(options.prometheusPath.c_str());
+}
+
+TEST(TestTelemetry, TestNonFiniteValues) {
+    Telemetry::Options options;
+    options.jsonPath = "test_non_finite.jsonl";
+    options.prometheusPath = "test_non_finite.prom";
+    std::remove(options.jsonPath.c_str());
+    {
+        Telemetry telemetry(options);
+        Telemetry::Step step;
+        step.loss = std::nanf("");
+        step.gradientNorm = INFINITY;
+        telemetry.record(step);
+        telemetry.flush();
+    }
+
+    // Still valid JSON, and what Prometheus expects
+    auto json = readFile(options.jsonPath);
+    ASSERT_NE(std::string::npos, json.find("\"loss\":null,\"gradient_norm\":null,"));
+    auto prometheus = readFile(options.prometheusPath);
+    ASSERT_NE(std::string::npos, prometheus.find("smolgrad_loss NaN\n"));
+    ASSERT_NE(std::string::npos, prometheus.find("smolgrad_gradient_norm +Inf\n"));
+
+    std::remove(options.jsonPath.c_str());
+    std::remove(options.prometheusPath.c_str());
+}
+
+TEST(TestTelemetry, TestUnwritablePath) {
+    Telemetry::Options options;
+    options.jsonPath = "no-such-directory/metrics.jsonl";
+    ASSERT_THROW(Telemetry{options}, std::runtime_error);
+}
+
+TEST(TestTelemetry, TestRotation) {
+    Telemetry::Options options;
+    options.jsonPath = "test_rotation.jsonl";
+    options.prometheusPath = "test_rotation.prom";
+    options.maxFileBytes = 1024;
+    options.maxFiles = 2;
+    for (auto suffix: {"", ".1", ".2", ".3"}) {
+        std::remove((options.jsonPath + suffix).c_str());
+    }
+    {
+        Telemetry telemetry(options);
+        for (size_t i = 0; i < 100; ++i) {
+            Telemetry::Step step;
+            step.step = i;
+            telemetry.record(step);
+            if (i % 10 == 9) {
+                telemetry.flush();
+            }
+        }
+    }
+    ASSERT_LE(readFile(options.jsonPath).size(), 1024u);
+    ASSERT_FALSE(readFile(options.jsonPath + ".2").empty());
+    ASSERT_TRUE(readFile(options.jsonPath + ".3").empty());
+
+    // The newest step is always in the live file
+    ASSERT_NE(std::string::npos, readFile(options.jsonPath).find("\"step\":99,"));
+
+    for (auto suffix: {"", ".1", ".2"}) {
+        std::remove((options.jsonPath + suffix).c_str());
+    }
+    std::remove(options.prometheusPath.c_str());
+}
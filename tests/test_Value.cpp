@@ -1,7 +1,9 @@
 //
 // Created by tom on 30/06/23.
 //
+#include <cmath>
 #include <gtest/gtest.h>
+#include <thread>
 #include "Value.h"
 
 TEST(TestValue, TestSize) {
@@ -140,4 +142,303 @@ TEST(TestDot, TestGradients) {
     auto c_data = *c->getData();
 
     ASSERT_EQ(c_data[0], 5.0f);
-}
\ No newline at end of file
+}
+
+TEST(TestGrad, TestLazyAllocation) {
+    auto a = new Value {2.0f};
+    auto b = new Value {-3.0f};
+    ASSERT_FALSE(a->hasGrad());
+
+    auto c = *a * *b;
+    ASSERT_FALSE(a->hasGrad());
+
+    c->backward();
+    ASSERT_TRUE(a->hasGrad());
+    ASSERT_EQ((*a->getGrad()->getData())[0], -3.0f);
+}
+
+TEST(TestGrad, TestRequiresGrad) {
+    auto a = new Value {2.0f};
+    auto b = new Value {-3.0f};
+    b->setRequiresGrad(false);
+
+    auto c = *a * *b;
+    ASSERT_TRUE(c->getRequiresGrad());
+    c->backward();
+
+    ASSERT_TRUE(a->hasGrad());
+    ASSERT_FALSE(b->hasGrad());
+    ASSERT_EQ((*b->getGrad()->getData())[0], 0.0f);
+
+    auto d = *b * 2.0f;
+    ASSERT_FALSE(d->getRequiresGrad());
+}
+
+TEST(TestGrad, TestClearGrad) {
+    auto a = new Value {2.0f};
+    auto b = new Value {-3.0f};
+
+    auto c = *a * *b;
+    c->backward();
+    a->clearGrad();
+    ASSERT_FALSE(a->hasGrad());
+    ASSERT_EQ((*a->getGrad()->getData())[0], 0.0f);
+
+    // Gradients accumulate from zero again after a clear
+    c->backward();
+    ASSERT_EQ((*a->getGrad()->getData())[0], -3.0f);
+    ASSERT_EQ((*b->getGrad()->getData())[0], 4.0f);
+
+    Value::clearGrads();
+    ASSERT_FALSE(a->hasGrad());
+    ASSERT_FALSE(b->hasGrad());
+}
+
+TEST(TestMove, TestMoveConstructor) {
+    Value a {1.0f, 2.0f, 3.0f};
+    auto data = a.getDataSpan().data();
+
+    Value b(std::move(a));
+    ASSERT_EQ(3, b.getSize());
+    ASSERT_EQ(data, b.getDataSpan().data());
+    ASSERT_EQ(0, a.getSize());
+}
+
+TEST(TestMove, TestMovedFromIsEmpty) {
+    Value a {1.0f, 2.0f};
+    a.getGradSpan()[0] = 1.0f;
+    a.getTangentSpan()[0] = 1.0f;
+    Value b(std::move(a));
+
+    // Every query sees an empty Value rather than a missing storage
+    ASSERT_FALSE(a.hasGrad());
+    ASSERT_FALSE(a.hasTangent());
+    ASSERT_FALSE(a.hasGradTangent());
+    ASSERT_TRUE(a.getDataSpan().empty());
+    ASSERT_TRUE(a.getGradSpan().empty());
+    ASSERT_TRUE(a.getDenseGradSpan().empty());
+    ASSERT_TRUE(a.getSparseGrad().empty());
+    ASSERT_EQ(0u, a.getVersion());
+    a.clearGrad();
+    a.clearTangent();
+    a.step(0.1f);
+    ASSERT_EQ(0, Value(a).getSize());
+
+    // and it can be assigned to again
+    a = Value {3.0f};
+    ASSERT_EQ(3.0f, a.at(0));
+    ASSERT_TRUE(b.hasGrad());
+    ASSERT_TRUE(b.hasTangent());
+}
+
+TEST(TestSpan, TestDataSpan) {
+    Value a {1.0f, 2.0f, 3.0f};
+    auto data = a.getDataSpan();
+    ASSERT_EQ(3, data.size());
+
+    data[1] = 5.0f;
+    ASSERT_EQ(5.0f, a[1]);
+}
+
+TEST(TestSpan, TestGradSpan) {
+    auto a = new Value {1.0f, 2.0f};
+    auto b = new Value {3.0f, 4.0f};
+    auto c = a->dot(*b);
+    c->backward();
+
+    auto grad = a->getGradSpan();
+    ASSERT_EQ(3.0f, grad[0]);
+    ASSERT_EQ(4.0f, grad[1]);
+}
+
+TEST(TestSlice, TestSliceSharesData) {
+    auto a = new Value {1.0f, 2.0f, 3.0f, 4.0f};
+    auto b = a->slice(1, 2);
+    ASSERT_EQ(2, b->getSize());
+    ASSERT_EQ(2.0f, b->at(0));
+    ASSERT_EQ(3.0f, b->at(1));
+
+    (*b)[0] = 7.0f;
+    ASSERT_EQ(7.0f, a->at(1));
+
+    ASSERT_THROW(a->slice(3, 2), std::out_of_range);
+}
+
+TEST(TestSlice, TestSliceBackward) {
+    auto a = new Value {1.0f, 2.0f, 3.0f, 4.0f};
+    auto b = a->slice(2, 2);
+    auto c = (*b * 3.0f)->sum();
+    c->backward();
+
+    auto grad = *a->getGrad()->getData();
+    ASSERT_EQ(0.0f, grad[0]);
+    ASSERT_EQ(0.0f, grad[1]);
+    ASSERT_EQ(3.0f, grad[2]);
+    ASSERT_EQ(3.0f, grad[3]);
+}
+
+TEST(TestConcat, TestConcatCopies) {
+    auto a = new Value {1.0f, 2.0f};
+    auto b = new Value {3.0f};
+    auto c = Value::concat({a, b});
+
+    auto data = *c->getData();
+    ASSERT_EQ(3, data.size());
+    ASSERT_EQ(1.0f, data[0]);
+    ASSERT_EQ(3.0f, data[2]);
+
+    auto d = (*c * *c)->sum();
+    d->backward();
+    ASSERT_EQ(4.0f, (*a->getGrad()->getData())[1]);
+    ASSERT_EQ(6.0f, (*b->getGrad()->getData())[0]);
+}
+
+TEST(TestConcat, TestConcatOutputSlicesIsView) {
+    auto a = new Value {1.0f, -2.0f};
+    Value buffer(2);
+
+    auto b = a->slice(0, 1)->exp(buffer.outputSlice(0, 1));
+    auto c = a->slice(1, 1)->tanh(buffer.outputSlice(1, 1));
+    auto d = Value::concat({b, c});
+
+    ASSERT_EQ(buffer.getDataSpan().data(), d->getDataSpan().data());
+    EXPECT_NEAR(std::exp(1.0f), d->at(0), 1e-5);
+    EXPECT_NEAR(std::tanh(-2.0f), d->at(1), 1e-5);
+
+    d->sum()->backward();
+    auto grad = *a->getGrad()->getData();
+    EXPECT_NEAR(std::exp(1.0f), grad[0], 1e-5);
+    EXPECT_NEAR(1.0f - std::tanh(-2.0f) * std::tanh(-2.0f), grad[1], 1e-5);
+}
+
+TEST(TestActivation, TestRelu) {
+    auto a = new Value {-1.0f, 2.0f};
+    auto b = a->relu();
+    ASSERT_EQ(0.0f, b->at(0));
+    ASSERT_EQ(2.0f, b->at(1));
+
+    b->sum()->backward();
+    auto grad = *a->getGrad()->getData();
+    ASSERT_EQ(0.0f, grad[0]);
+    ASSERT_EQ(1.0f, grad[1]);
+}
+
+TEST(TestActivation, TestSigmoid) {
+    auto a = new Value {0.0f, 2.0f};
+    auto b = a->sigmoid();
+    EXPECT_NEAR(0.5f, b->at(0), 1e-6);
+
+    b->sum()->backward();
+    auto grad = *a->getGrad()->getData();
+    float s = 1.0f / (1.0f + std::exp(-2.0f));
+    EXPECT_NEAR(0.25f, grad[0], 1e-6);
+    EXPECT_NEAR(s * (1.0f - s), grad[1], 1e-6);
+}
+
+TEST(TestActivation, TestGeluMatchesFiniteDifference) {
+    const float h = 1e-3f;
+    for (float x : {-2.0f, -0.5f, 0.0f, 0.7f, 3.0f}) {
+        auto a = new Value {x};
+        a->gelu()->backward();
+
+        auto up = (new Value {x + h})->gelu()->at(0);
+        auto down = (new Value {x - h})->gelu()->at(0);
+        EXPECT_NEAR((up - down) / (2.0f * h), a->getGradSpan()[0], 1e-3);
+    }
+    EXPECT_NEAR(0.8412f, (new Value {1.0f})->gelu()->at(0), 1e-3);
+}
+
+TEST(TestLoss, TestMse) {
+    auto a = new Value {1.0f, 2.0f};
+    auto b = new Value {0.0f, 4.0f};
+    auto loss = a->mse(*b);
+    EXPECT_NEAR(2.5f, loss->at(0), 1e-6);
+
+    loss->backward();
+    auto gradA = *a->getGrad()->getData();
+    auto gradB = *b->getGrad()->getData();
+    EXPECT_NEAR(1.0f, gradA[0], 1e-6);
+    EXPECT_NEAR(-2.0f, gradA[1], 1e-6);
+    EXPECT_NEAR(-1.0f, gradB[0], 1e-6);
+    EXPECT_NEAR(2.0f, gradB[1], 1e-6);
+}
+
+TEST(TestLoss, TestSoftmaxCrossEntropy) {
+    auto logits = new Value {1.0f, 2.0f, 3.0f};
+    auto target = new Value {0.0f, 0.0f, 1.0f};
+    target->setRequiresGrad(false);
+
+    auto loss = logits->softmaxCrossEntropy(*target);
+    float total = std::exp(1.0f) + std::exp(2.0f) + std::exp(3.0f);
+    EXPECT_NEAR(-std::log(std::exp(3.0f) / total), loss->at(0), 1e-5);
+
+    loss->backward();
+    auto grad = *logits->getGrad()->getData();
+    EXPECT_NEAR(std::exp(1.0f) / total, grad[0], 1e-5);
+    EXPECT_NEAR(std::exp(2.0f) / total, grad[1], 1e-5);
+    EXPECT_NEAR(std::exp(3.0f) / total - 1.0f, grad[2], 1e-5);
+
+    // Large logits must not overflow
+    auto large = new Value {1000.0f, 0.0f, 0.0f};
+    EXPECT_NEAR(1000.0f, large->softmaxCrossEntropy(*target)->at(0), 1e-2);
+}
+
+TEST(TestForwardMode, TestTangents) {
+    auto a = new Value {2.0f, 0.5f};
+    auto b = new Value {-3.0f, 4.0f};
+    auto direction = a->getTangentSpan();
+    direction[0] = 1.0f;
+    direction[1] = 2.0f;
+
+    // f = sum(exp(a * b) + a^2), df = sum((exp(a * b) b + 2 a) da)
+    auto f = (*(*a * *b)->exp() + *a->pow(2.0f))->sum();
+    ASSERT_TRUE(f->hasTangent());
+    ASSERT_FALSE(b->hasTangent());
+
+    float expected = (std::exp(-6.0f) * -3.0f + 4.0f) * 1.0f + (std::exp(2.0f) * 4.0f + 1.0f) * 2.0f;
+    EXPECT_NEAR(expected, f->getTangentSpan()[0], 1e-4);
+}
+
+TEST(TestForwardMode, TestTangentsMatchBackward) {
+    auto a = new Value {0.3f, -0.7f, 1.2f};
+    auto target = new Value {0.0f, 1.0f, 0.0f};
+    target->setRequiresGrad(false);
+
+    auto loss = Value::concat({a->slice(0, 1)->tanh(), a->slice(1, 2)->sigmoid()})->softmaxCrossEntropy(*target);
+    loss->backward();
+    auto grad = *a->getGrad()->getData();
+
+    for (size_t j = 0; j < 3; ++j) {
+        auto point = new Value(*a);
+        auto direction = point->getTangentSpan();
+        direction[j] = 1.0f;
+        auto tangentLoss = Value::concat({point->slice(0, 1)->tanh(), point->slice(1, 2)->sigmoid()})
+                ->softmaxCrossEntropy(*target);
+        EXPECT_NEAR(grad[j], tangentLoss->getTangentSpan()[0], 1e-5);
+    }
+}
+
+TEST(TestNoGrad, TestNoGraphRecorded) {
+    auto a = new Value {2.0f};
+    Value *b;
+    {
+        Value::NoGrad noGrad;
+        b = (*a * 3.0f)->tanh();
+    }
+    ASSERT_FALSE(b->getRequiresGrad());
+    b->backward();
+    ASSERT_FALSE(a->hasGrad());
+
+    auto c = *a * 3.0f;
+    ASSERT_TRUE(c->getRequiresGrad());
+}
+
+TEST(TestNoGrad, TestPerThread) {
+    auto a = new Value {2.0f};
+    Value::NoGrad noGrad;
+    Value *other = nullptr;
+    std::thread thread([&]() { other = *a * 3.0f; });
+    thread.join();
+    ASSERT_TRUE(other->getRequiresGrad());
+    ASSERT_FALSE((*a * 3.0f)->getRequiresGrad());
+}